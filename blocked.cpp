@@ -0,0 +1,571 @@
+
+#include <limits>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+
+#include "include/Executor.h"
+
+using namespace rabid;
+
+using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+
+/// Reusable barrier for the thread-per-core baselines.
+///
+class Barrier {
+ public:
+  Barrier( size_t count_arg )
+  : count( count_arg )
+  {}
+
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock{ mutex };
+    const auto current = generation;
+    if( ++arrived == count )
+    {
+      arrived = 0;
+      generation += 1;
+      condition.notify_all();
+    }
+    else
+    {
+      condition.wait( lock, [&]{ return generation != current; } );
+    }
+  }
+
+ protected:
+  const size_t count;
+  size_t arrived = 0;
+  size_t generation = 0;
+  std::mutex mutex;
+  std::condition_variable condition;
+};
+
+/// Jacobi iteration over a square grid with a fixed boundary.
+///
+/// The top boundary is held at 1.0 and the others at 0.0. Every iteration
+/// replaces each interior point with the mean of its four neighbors.
+///
+struct Jacobi {
+  size_t size;
+  size_t iterations;
+
+  static constexpr double top = 1.0;
+
+  /// Apply one iteration to a block of rows/columns with the given strides.
+  ///
+  static void sweep( const double * in, double * out, size_t rows, size_t columns, size_t stride )
+  {
+    for( size_t row = 1; row <= rows; ++row )
+    {
+      const double * above = in + ( row - 1 ) * stride;
+      const double * center = in + row * stride;
+      const double * below = in + ( row + 1 ) * stride;
+      double * result = out + row * stride;
+      for( size_t column = 1; column <= columns; ++column )
+      {
+        result[ column ] = 0.25 * ( above[ column ] + below[ column ] + center[ column - 1 ] + center[ column + 1 ] );
+      }
+    }
+  }
+};
+
+/// Jacobi with tiles owned by fixed workers, exchanging halos as messages.
+///
+/// Each tile keeps two (B+2)^2 grids whose outer ring holds ghost values.
+/// After computing step s, a tile sends its edges to the owners of its
+/// neighboring tiles, who copy them into the ghost ring of the grid for
+/// step s. A tile computes step s+1 once all its neighbors' step s halos
+/// have arrived. Neighbors are never more than one step apart, so two
+/// grids (and two arrival counts) suffice.
+///
+auto jacobi_with_executor( const Jacobi & problem,
+  size_t block,
+  size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::pair<std::chrono::steady_clock::duration, std::vector<double>>
+{
+  Exec executor{ concurrency };
+
+  const size_t tiles = ( problem.size + block - 1 ) / block;
+  const size_t stride = block + 2;
+
+  enum Side : size_t { north, south, west, east };
+
+  struct alignas(64) Tile {
+    std::unique_ptr<double[]> grids[ 2 ];
+    size_t arrived[ 2 ] = { 0, 0 };
+    size_t neighbors = 0;
+    size_t step = 0;
+    size_t row = 0;
+    size_t column = 0;
+  };
+
+  struct State {
+    const Jacobi & problem;
+    const size_t tiles;
+    const size_t block;
+    const size_t stride;
+    const size_t workers;
+    std::unique_ptr<Tile[]> tile;
+    rabid::detail::Join & join;
+
+    size_t owner( size_t index ) const { return index % workers; }
+
+    /// Offset of the index'th point along a side of the interior (or of
+    /// the ghost ring).
+    ///
+    size_t edge( Side side, bool ghost, size_t index ) const
+    {
+      const size_t near = ghost ? 0 : 1;
+      const size_t far = ghost ? block + 1 : block;
+      switch( side )
+      {
+        case north: return near * stride + index;
+        case south: return far * stride + index;
+        case west: return index * stride + near;
+        case east: default: return index * stride + far;
+      }
+    }
+
+    /// Compute as many steps as available halos allow.
+    ///
+    void advance( size_t index )
+    {
+      auto & current = tile[ index ];
+      while( current.step < problem.iterations && current.arrived[ current.step % 2 ] == current.neighbors )
+      {
+        current.arrived[ current.step % 2 ] = 0;
+        const auto parity = ( current.step + 1 ) % 2;
+        Jacobi::sweep( current.grids[ current.step % 2 ].get(), current.grids[ parity ].get(), block, block, stride );
+        current.step += 1;
+        if( current.step == problem.iterations )
+        {
+          // Nobody consumes the final halos. Skipping them also ensures no
+          // message is in flight once every tile has finished.
+          //
+          break;
+        }
+
+        const double * grid = current.grids[ parity ].get();
+        const auto send = [&]( size_t neighbor, Side side, Side opposite )
+        {
+          std::vector<double> values;
+          values.reserve( block );
+          for( size_t point = 1; point <= block; ++point )
+          {
+            values.push_back( grid[ edge( side, false, point ) ] );
+          }
+          Exec::async( owner( neighbor ), [this,neighbor,opposite,parity,values]
+            {
+              auto & target = tile[ neighbor ];
+              double * ghost = target.grids[ parity ].get();
+              for( size_t point = 1; point <= block; ++point )
+              {
+                ghost[ edge( opposite, true, point ) ] = values[ point - 1 ];
+              }
+              target.arrived[ parity ] += 1;
+              advance( neighbor );
+            });
+        };
+
+        if( current.row > 0 ) send( index - tiles, north, south );
+        if( current.row + 1 < tiles ) send( index + tiles, south, north );
+        if( current.column > 0 ) send( index - 1, west, east );
+        if( current.column + 1 < tiles ) send( index + 1, east, west );
+      }
+
+      if( current.step == problem.iterations && current.arrived[ 0 ] != std::numeric_limits<size_t>::max() )
+      {
+        current.arrived[ 0 ] = std::numeric_limits<size_t>::max();
+        join.notify();
+      }
+    }
+  };
+
+  rabid::detail::Join join{ ssize_t( tiles * tiles ) };
+  State state{ problem, tiles, block, stride, concurrency, std::make_unique<Tile[]>( tiles * tiles ), join };
+
+  for( size_t index = 0; index < tiles * tiles; ++index )
+  {
+    auto & tile = state.tile[ index ];
+    tile.row = index / tiles;
+    tile.column = index % tiles;
+    tile.neighbors = size_t( tile.row > 0 ) + size_t( tile.row + 1 < tiles ) + size_t( tile.column > 0 ) + size_t( tile.column + 1 < tiles );
+    tile.arrived[ 0 ] = tile.neighbors;
+  }
+
+  // Tiles are allocated and initialized by their owners, so the pages
+  // land in the owner's local memory and cache. All tiles must exist before
+  // the first halo is sent.
+  //
+  executor.wake();
+  rabid::detail::Join allocated{ ssize_t( tiles * tiles ) };
+  for( size_t index = 0; index < tiles * tiles; ++index )
+  {
+    executor.inject( state.owner( index ), [&state,&allocated,index]
+      {
+        auto & tile = state.tile[ index ];
+        for( auto & grid : tile.grids )
+        {
+          grid = std::make_unique<double[]>( state.stride * state.stride );
+          if( tile.row == 0 )
+          {
+            for( size_t point = 1; point <= state.block; ++point )
+            {
+              grid[ state.edge( north, true, point ) ] = Jacobi::top;
+            }
+          }
+        }
+        allocated.notify();
+      });
+  }
+  allocated.wait();
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  for( size_t index = 0; index < tiles * tiles; ++index )
+  {
+    executor.inject( state.owner( index ), [&state,index]{ state.advance( index ); } );
+  }
+
+  join.wait();
+  const auto end = std::chrono::steady_clock::now();
+
+  std::vector<double> result( problem.size * problem.size );
+  for( size_t index = 0; index < tiles * tiles; ++index )
+  {
+    const auto & tile = state.tile[ index ];
+    const double * grid = tile.grids[ problem.iterations % 2 ].get();
+    for( size_t row = 0; row < block; ++row )
+    {
+      for( size_t column = 0; column < block; ++column )
+      {
+        result[ ( tile.row * block + row ) * problem.size + tile.column * block + column ] = grid[ ( row + 1 ) * stride + column + 1 ];
+      }
+    }
+  }
+  return { end - begin, std::move( result ) };
+}
+
+/// Jacobi with a thread per core, each sweeping a strip of rows of a shared
+/// grid, separated by a barrier each iteration.
+///
+auto jacobi_with_threads( const Jacobi & problem,
+  size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::pair<std::chrono::steady_clock::duration, std::vector<double>>
+{
+  const size_t stride = problem.size + 2;
+  std::vector<double> grids[ 2 ];
+  for( auto & grid : grids )
+  {
+    grid.assign( stride * stride, 0.0 );
+    std::fill( grid.begin() + 1, grid.begin() + ssize_t( stride - 1 ), Jacobi::top );
+  }
+
+  Barrier barrier{ concurrency };
+  std::vector<std::thread> threads;
+  threads.reserve( concurrency );
+
+  struct Job {
+    size_t index;
+    size_t concurrency;
+    const Jacobi & problem;
+    std::vector<double> * grids;
+    Barrier & barrier;
+
+    void operator()()
+    {
+      const size_t stride = problem.size + 2;
+      const size_t first = problem.size * index / concurrency;
+      const size_t last = problem.size * ( index + 1 ) / concurrency;
+      for( size_t step = 0; step < problem.iterations; ++step )
+      {
+        Jacobi::sweep( grids[ step % 2 ].data() + first * stride,
+          grids[ ( step + 1 ) % 2 ].data() + first * stride,
+          last - first, problem.size, stride );
+        barrier.wait();
+      }
+    }
+  };
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  for( size_t job = 0; job < concurrency; ++job )
+  {
+    threads.emplace_back( Job{ job, concurrency, problem, grids, barrier } );
+  }
+
+  for( auto & thread : threads )
+  {
+    thread.join();
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+
+  std::vector<double> result( problem.size * problem.size );
+  const auto & grid = grids[ problem.iterations % 2 ];
+  for( size_t row = 0; row < problem.size; ++row )
+  {
+    for( size_t column = 0; column < problem.size; ++column )
+    {
+      result[ row * problem.size + column ] = grid[ ( row + 1 ) * stride + column + 1 ];
+    }
+  }
+  return { end - begin, std::move( result ) };
+}
+
+/// Square matrices for C = A * B.
+///
+struct Gemm {
+  size_t size;
+  std::vector<double> a;
+  std::vector<double> b;
+
+  Gemm( size_t size_arg )
+  : size( size_arg )
+  , a( size * size )
+  , b( size * size )
+  {
+    std::mt19937_64 random{ size };
+    std::uniform_real_distribution<double> uniform{ -1.0, 1.0 };
+    for( auto & value : a ) value = uniform( random );
+    for( auto & value : b ) value = uniform( random );
+  }
+
+  /// Accumulate a block product: c += a * b, all with the given strides.
+  ///
+  static void multiply( const double * a, size_t a_stride, const double * b, size_t b_stride, double * c, size_t c_stride, size_t rows, size_t inner, size_t columns )
+  {
+    for( size_t row = 0; row < rows; ++row )
+    {
+      for( size_t k = 0; k < inner; ++k )
+      {
+        const double scale = a[ row * a_stride + k ];
+        const double * source = b + k * b_stride;
+        double * result = c + row * c_stride;
+        for( size_t column = 0; column < columns; ++column )
+        {
+          result[ column ] += scale * source[ column ];
+        }
+      }
+    }
+  }
+};
+
+/// Tiled GEMM with C tiles owned by fixed workers.
+///
+/// Tile (i,j) of every matrix is owned by worker (i * T + j) % workers. Owners
+/// of A(i,k) and B(k,j) broadcast each panel tile to the owners of row i
+/// (resp. column j) of C as messages. C(i,j) multiplies A(i,k) * B(k,j) as
+/// soon as both have arrived, so products overlap with panel exchange.
+///
+auto gemm_with_executor( const Gemm & problem,
+  size_t block,
+  size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::pair<std::chrono::steady_clock::duration, std::vector<double>>
+{
+  Exec executor{ concurrency };
+
+  const size_t tiles = problem.size / block;
+  using Panel = std::shared_ptr<const std::vector<double>>;
+
+  struct alignas(64) Tile {
+    std::vector<double> c;
+    std::vector<Panel> a;
+    std::vector<Panel> b;
+    size_t products = 0;
+  };
+
+  struct State {
+    const Gemm & problem;
+    const size_t tiles;
+    const size_t block;
+    const size_t workers;
+    std::unique_ptr<Tile[]> tile;
+    rabid::detail::Join & join;
+
+    size_t owner( size_t row, size_t column ) const { return ( row * tiles + column ) % workers; }
+
+    /// Copy a tile of a row-major matrix into a contiguous panel.
+    ///
+    Panel extract( const std::vector<double> & matrix, size_t row, size_t column ) const
+    {
+      auto panel = std::make_shared<std::vector<double>>( block * block );
+      for( size_t index = 0; index < block; ++index )
+      {
+        const auto source = matrix.begin() + ssize_t( ( row * block + index ) * problem.size + column * block );
+        std::copy( source, source + ssize_t( block ), panel->begin() + ssize_t( index * block ) );
+      }
+      return panel;
+    }
+
+    /// Accept a panel for tile (row, column) at step k on the tile's owner.
+    ///
+    void accept( size_t row, size_t column, size_t k, bool left, const Panel & panel )
+    {
+      auto & current = tile[ row * tiles + column ];
+      if( current.c.empty() )
+      {
+        current.c.assign( block * block, 0.0 );
+        current.a.resize( tiles );
+        current.b.resize( tiles );
+      }
+
+      ( left ? current.a : current.b )[ k ] = panel;
+      if( current.a[ k ] && current.b[ k ] )
+      {
+        Gemm::multiply( current.a[ k ]->data(), block, current.b[ k ]->data(), block, current.c.data(), block, block, block, block );
+        current.a[ k ] = nullptr;
+        current.b[ k ] = nullptr;
+        if( ++current.products == tiles )
+        {
+          join.notify();
+        }
+      }
+    }
+  };
+
+  rabid::detail::Join join{ ssize_t( tiles * tiles ) };
+  State state{ problem, tiles, block, concurrency, std::make_unique<Tile[]>( tiles * tiles ), join };
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  executor.wake();
+  for( size_t row = 0; row < tiles; ++row )
+  {
+    for( size_t column = 0; column < tiles; ++column )
+    {
+      executor.inject( state.owner( row, column ), [&state,row,column]
+        {
+          // A(row,column) is needed by C(row,*) at step k = column, and
+          // B(row,column) by C(*,column) at step k = row.
+          //
+          const auto a = state.extract( state.problem.a, row, column );
+          const auto b = state.extract( state.problem.b, row, column );
+          for( size_t index = 0; index < state.tiles; ++index )
+          {
+            Exec::async( state.owner( row, index ), [&state,row,index,column,a]{ state.accept( row, index, column, true, a ); } );
+            Exec::async( state.owner( index, column ), [&state,index,column,row,b]{ state.accept( index, column, row, false, b ); } );
+          }
+        });
+    }
+  }
+
+  join.wait();
+  const auto end = std::chrono::steady_clock::now();
+
+  std::vector<double> result( problem.size * problem.size );
+  for( size_t row = 0; row < tiles; ++row )
+  {
+    for( size_t column = 0; column < tiles; ++column )
+    {
+      const auto & c = state.tile[ row * tiles + column ].c;
+      for( size_t index = 0; index < block; ++index )
+      {
+        std::copy( c.begin() + ssize_t( index * block ), c.begin() + ssize_t( ( index + 1 ) * block ),
+          result.begin() + ssize_t( ( row * block + index ) * problem.size + column * block ) );
+      }
+    }
+  }
+  return { end - begin, std::move( result ) };
+}
+
+/// Tiled GEMM with a thread per core, each computing a strip of rows of C
+/// directly from the shared A and B.
+///
+auto gemm_with_threads( const Gemm & problem,
+  size_t block,
+  size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::pair<std::chrono::steady_clock::duration, std::vector<double>>
+{
+  std::vector<double> c( problem.size * problem.size, 0.0 );
+  std::vector<std::thread> threads;
+  threads.reserve( concurrency );
+
+  struct Job {
+    size_t index;
+    size_t concurrency;
+    size_t block;
+    const Gemm & problem;
+    std::vector<double> & c;
+
+    void operator()()
+    {
+      const size_t tiles = problem.size / block;
+      for( size_t row = tiles * index / concurrency; row < tiles * ( index + 1 ) / concurrency; ++row )
+      {
+        for( size_t k = 0; k < tiles; ++k )
+        {
+          for( size_t column = 0; column < tiles; ++column )
+          {
+            Gemm::multiply( problem.a.data() + row * block * problem.size + k * block, problem.size,
+              problem.b.data() + k * block * problem.size + column * block, problem.size,
+              c.data() + row * block * problem.size + column * block, problem.size,
+              block, block, block );
+          }
+        }
+      }
+    }
+  };
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  for( size_t job = 0; job < concurrency; ++job )
+  {
+    threads.emplace_back( Job{ job, concurrency, block, problem, c } );
+  }
+
+  for( auto & thread : threads )
+  {
+    thread.join();
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+  return { end - begin, std::move( c ) };
+}
+
+double difference( const std::vector<double> & a, const std::vector<double> & b )
+{
+  double result = 0;
+  for( size_t index = 0; index < a.size(); ++index )
+  {
+    result = std::max( result, std::abs( a[ index ] - b[ index ] ) );
+  }
+  return result;
+}
+
+int main( int argc, char ** argv )
+{
+  const size_t size = ( argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 1024 );
+  const size_t block = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 64 );
+  const size_t iterations = ( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : 100 );
+  const size_t concurrency = ( argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
+
+  if( size % block )
+  {
+    std::cerr << "size must be a multiple of block" << std::endl;
+    return 1;
+  }
+
+  {
+    const Jacobi problem{ size, iterations };
+    const auto executor = jacobi_with_executor( problem, block, concurrency );
+    const auto threads = jacobi_with_threads( problem, concurrency );
+    std::cout << "jacobi executor: " << std::chrono::duration_cast<std::chrono::microseconds>( executor.first ).count() << " usec" << std::endl;
+    std::cout << "jacobi threads: " << std::chrono::duration_cast<std::chrono::microseconds>( threads.first ).count() << " usec" << std::endl;
+    std::cout << "jacobi max difference: " << difference( executor.second, threads.second ) << std::endl;
+  }
+  {
+    const Gemm problem{ size };
+    const auto executor = gemm_with_executor( problem, block, concurrency );
+    const auto threads = gemm_with_threads( problem, block, concurrency );
+    std::cout << "gemm executor: " << std::chrono::duration_cast<std::chrono::microseconds>( executor.first ).count() << " usec" << std::endl;
+    std::cout << "gemm threads: " << std::chrono::duration_cast<std::chrono::microseconds>( threads.first ).count() << " usec" << std::endl;
+    std::cout << "gemm max difference: " << difference( executor.second, threads.second ) << std::endl;
+  }
+
+  return 0;
+}
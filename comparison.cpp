@@ -3,206 +3,17 @@
 #include <unordered_map>
 #include <iostream>
 #include <chrono>
-
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/mman.h>
+#include <cmath>
+#include <type_traits>
 
 #include "include/Executor.h"
+#include "include/mapped_file.h"
+#include "include/tokenizer.h"
+#include "include/sketch.h"
+#include "include/pipeline.h"
 
 using namespace rabid;
 
-class MappedFile {
- public:
-  MappedFile() = default;
-
-  template < typename ...Args>
-  MappedFile( Args && ...args )
-  {
-    open( std::forward<Args>( args )... );
-  }
-
-  ~MappedFile() { close(); }
-
-  MappedFile( const MappedFile & ) = delete;
-  MappedFile( MappedFile && other )
-  : base( other.base )
-  , bytes( other.bytes )
-  {
-    other.base = nullptr;
-    other.bytes = 0;
-  }
-
-  MappedFile & operator = ( const MappedFile & ) = delete;
-  MappedFile & operator = ( MappedFile && other )
-  {
-    close();
-    base = other.base;
-    bytes = other.bytes;
-    other.base = nullptr;
-    other.bytes = 0;
-    return *this;
-  }
-
-  bool open( const std::string & path, size_t offset = 0, size_t length = std::numeric_limits<size_t>::max() )
-  {
-    int fd = ::open( path.c_str(), O_RDONLY );
-    if( fd >= 0 )
-    {
-      bool result = open( fd, offset, length );
-      ::close( fd ); 
-      return result;
-    }
-    return false;
-  }
-
-  bool open( const int fd, size_t offset = 0, size_t length = std::numeric_limits<size_t>::max() )
-  {
-      struct stat stat;
-      if( 0 == ::fstat( fd, &stat ) )
-      {
-        offset = std::min( offset, size_t(stat.st_size) );
-        length = std::min( length, size_t(stat.st_size) );
-
-        close();
-
-        base = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, fd, off_t(offset) );
-        if( base == MAP_FAILED )
-        {
-          base = nullptr;
-        }
-        else
-        {
-          bytes = length;
-          return true;
-        }
-      }
-      return false;
-  }
-
-  void close()
-  {
-    if( base )
-    {
-      ::munmap( base, bytes );
-      base = nullptr;
-      bytes = 0;
-    }
-  }
-
-  size_t warm() const
-  {
-    size_t total;
-    for( size_t index = 0; index < size<uint8_t>(); ++index )
-    {
-      total += array<uint8_t>()[ index ];
-    }
-    return total;
-  }
-
-  bool empty() const { return base == nullptr || bytes == 0; }
-
-  template < typename T >
-  size_t size() const { return bytes/sizeof(T); }
-
-  template < typename T >
-  const T * array() const { return reinterpret_cast<const T*>( base ); }
-
- protected:
-  void * base = nullptr;
-  size_t bytes = 0;
-};
-
-template < typename CharT, typename Traits = std::char_traits<CharT> >
-struct Token {
-  const CharT * begin;
-  const CharT * end;
-
-  size_t size() const { return size_t(end - begin); }
-
-  size_t bucket( size_t concurrency ) const { return (size_t(*begin) + size()) % concurrency; }
-
-  friend bool operator == ( const Token & a, const Token & b )
-  {
-    return a.size() != b.size() || Traits::compare( a.begin, b.begin, a.size() ) == 0;
-  } 
-
-  friend std::ostream & operator << ( std::ostream & stream, const Token & token )
-  {
-    if( token.begin != token.end )
-    {
-      stream.write( token.begin, token.end - token.begin );
-    }
-    return stream;
-  }
-};
-
-
-template < typename CharT, typename Traits = std::char_traits<CharT> >
-class Tokenizer {
- public:
-
-  bool empty() const { return begin == end; }
-
-  Token<CharT> next()
-  {
-    Token<CharT> result{};
-
-    result.begin = begin;
-
-    while( begin != end && !std::isspace(Traits::to_int_type(*begin)) )
-    {
-      begin += 1;
-    }
-    result.end = begin;
-
-    while( begin != end && std::isspace(Traits::to_int_type(*begin)) )
-    {
-      begin += 1;
-    }
-
-    return result;
-  }
-
-  Tokenizer( const CharT * array, size_t size )
-  : begin( array )
-  , end( array + size )
-  {
-    while( begin != end && std::isspace(Traits::to_int_type(*begin)) )
-    {
-      begin += 1;
-    }
-  }
- protected:
-  const CharT * begin;
-  const CharT * const end;
-};
-
-namespace std {
-
-  template < typename T >
-  size_t hash_combine( size_t seed, const T & value )
-  {
-    return (seed << 1) ^ hash<T>{}( value );
-  }
-
-  template < typename CharT >
-  struct hash<Token<CharT>>
-  {
-    size_t operator() ( const Token<CharT> & token ) const
-    {
-      size_t seed = 0;
-      for( auto current = token.begin; current != token.end; ++current )
-      {
-        seed = hash_combine( seed, *current );
-      }
-      return seed;
-    }
-  };
-}
-
 struct Freq {
   size_t count = 0;
 };
@@ -249,6 +60,7 @@ auto freq_with_executor( const MappedFile & file,
   Join join{ ssize_t(jobs) };
   const auto begin = std::chrono::steady_clock::now();
 
+  executor.wake();
   for( size_t job = 0; job < jobs; ++job )
   {
     Tokenizer<CharT> tokenizer{ file.array<CharT>() + job * stride, stride };
@@ -301,6 +113,7 @@ auto freq_with_executor2( const MappedFile & file,
   Join join{ ssize_t(jobs) };
   const auto begin = std::chrono::steady_clock::now();
 
+  executor.wake();
   for( size_t job = 0; job < jobs; ++job )
   {
     Tokenizer<CharT> tokenizer{ file.array<CharT>() + job * stride, stride };
@@ -312,6 +125,236 @@ auto freq_with_executor2( const MappedFile & file,
   return end - begin;
 }
 
+/// Token frequency with adaptive granularity instead of a job multiplier.
+///
+/// The file is a single range split lazily by Executor::split() as workers go
+/// idle. Each piece counts the tokens that start within it into its worker's
+/// map, reading past its end to finish the last token.
+///
+template <typename CharT>
+auto freq_with_executor_adaptive( const MappedFile & file,
+  size_t grain = 64 * 1024,
+  size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::chrono::steady_clock::duration
+{
+  using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+  Exec executor{ concurrency };
+
+  using FreqMap = std::unordered_map<Token<CharT>,Freq>;
+  const auto map = std::make_unique<FreqMap[]>( concurrency );
+
+  using rabid::detail::Join;
+  using Traits = std::char_traits<CharT>;
+
+  const CharT * const text = file.array<CharT>();
+  const size_t size = file.size<CharT>();
+  const auto space = [text]( size_t index ) { return std::isspace( Traits::to_int_type( text[ index ] ) ); };
+
+  Join join{ 1 };
+  const auto begin = std::chrono::steady_clock::now();
+
+  executor.wake();
+  executor.inject( 0, [&]
+    {
+      Exec::split( 0, size, grain, [&]( size_t first, size_t last )
+        {
+          while( first < last && first > 0 && !space( first - 1 ) )
+          {
+            first += 1;
+          }
+          while( first < last && last < size && !space( last - 1 ) && !space( last ) )
+          {
+            last += 1;
+          }
+
+          auto & buckets = map[ Exec::current() ];
+          Tokenizer<CharT> tokenizer{ text + first, last - first };
+          while( !tokenizer.empty() )
+          {
+            buckets[ tokenizer.next() ].count += 1;
+          }
+        },
+        [&join]{ join.notify(); } );
+    });
+
+  join.wait();
+  const auto end = std::chrono::steady_clock::now();
+  return end - begin;
+}
+
+/// FNV-1a token hash for sketches.
+///
+/// std::hash<Token> folds characters with shifts and xors, so short tokens
+/// collide (e.g. "is" and "be"). Exact maps resolve that by comparing keys,
+/// but a sketch would count both tokens as one.
+///
+template <typename CharT>
+struct TokenHash {
+  size_t operator() ( const Token<CharT> & token ) const
+  {
+    const std::uint64_t prime = 1099511628211u;
+    std::uint64_t hash = 14695981039346656037u;
+    for( auto current = token.begin; current != token.end; ++current )
+    {
+      hash = ( hash ^ static_cast<std::make_unsigned_t<CharT>>( *current ) ) * prime;
+    }
+    return size_t( hash );
+  }
+};
+
+/// Heavy hitters and distinct token count in constant memory.
+///
+/// Like freq_with_executor_adaptive, but each worker feeds fixed-size
+/// sketches instead of an exact map, and the sketches are combined with a
+/// tree reduction rather than left partitioned.
+///
+/// After timing, the merged estimates are printed beside exact counts from a
+/// sequential pass, flagging a MISMATCH if a heavy hitter is underestimated
+/// (Count-Min never does) or the distinct count is off by more than three
+/// standard errors.
+///
+template <typename CharT>
+auto sketch_with_executor( const MappedFile & file,
+  size_t grain = 64 * 1024,
+  size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::chrono::steady_clock::duration
+{
+  using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+  Exec executor{ concurrency };
+
+  struct Summary {
+    sketch::HeavyHitters<Token<CharT>,TokenHash<CharT>> hitters{ 16, 4096, 4 };
+    sketch::HyperLogLog<Token<CharT>,TokenHash<CharT>> distinct{ 14 };
+
+    void merge( const Summary & other )
+    {
+      hitters.merge( other.hitters );
+      distinct.merge( other.distinct );
+    }
+  };
+  const auto summaries = std::make_unique<Summary[]>( concurrency );
+
+  using rabid::detail::Join;
+  using Traits = std::char_traits<CharT>;
+
+  const CharT * const text = file.array<CharT>();
+  const size_t size = file.size<CharT>();
+  const auto space = [text]( size_t index ) { return std::isspace( Traits::to_int_type( text[ index ] ) ); };
+
+  Join join{ 1 };
+  sketch::Reduction<Exec,Summary> reduction{ summaries.get(), concurrency, [&join]( Summary & ){ join.notify(); } };
+  const auto begin = std::chrono::steady_clock::now();
+
+  executor.wake();
+  executor.inject( 0, [&]
+    {
+      Exec::split( 0, size, grain, [&]( size_t first, size_t last )
+        {
+          while( first < last && first > 0 && !space( first - 1 ) )
+          {
+            first += 1;
+          }
+          while( first < last && last < size && !space( last - 1 ) && !space( last ) )
+          {
+            last += 1;
+          }
+
+          auto & summary = summaries[ Exec::current() ];
+          Tokenizer<CharT> tokenizer{ text + first, last - first };
+          while( !tokenizer.empty() )
+          {
+            const auto token = tokenizer.next();
+            summary.hitters.insert( token );
+            summary.distinct.insert( token );
+          }
+        },
+        [&reduction]
+        {
+          for( size_t index = 0; index < Exec::concurrency(); ++index )
+          {
+            Exec::async( index, [&reduction]{ reduction.arrive(); } );
+          }
+        });
+    });
+
+  join.wait();
+  const auto end = std::chrono::steady_clock::now();
+
+  std::unordered_map<Token<CharT>,size_t> exact;
+  Tokenizer<CharT> tokenizer{ text, size };
+  while( !tokenizer.empty() )
+  {
+    exact[ tokenizer.next() ] += 1;
+  }
+
+  const auto & merged = summaries[ 0 ];
+  const auto distinct = merged.distinct.estimate();
+  const auto error = std::abs( distinct - double( exact.size() ) ) / double( exact.size() );
+  bool mismatch = error > 3 * 1.04 / std::sqrt( double( 1 << 14 ) );
+
+  std::cout << "sketch: ~" << size_t( distinct ) << " distinct (exact " << exact.size() << "), top";
+  const auto top = merged.hitters.top();
+  for( size_t rank = 0; rank < std::min( top.size(), size_t{ 3 } ); ++rank )
+  {
+    const auto count = exact[ top[ rank ].first ];
+    mismatch = mismatch || top[ rank ].second < count;
+    std::cout << " '" << top[ rank ].first << "' ~" << top[ rank ].second << " (exact " << count << ")";
+  }
+  std::cout << ( mismatch ? ", MISMATCH" : "" ) << std::endl;
+
+  return end - begin;
+}
+
+/// Token frequency expressed as a pipeline.
+///
+/// Tokenizing and routing fuse into one loop per chunk, and tokens cross
+/// workers only in group_by()'s batches.
+///
+template <typename CharT>
+auto freq_with_pipeline( const MappedFile & file,
+  size_t grain = 64 * 1024,
+  size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::chrono::steady_clock::duration
+{
+  using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+  Exec executor{ concurrency };
+
+  using Traits = std::char_traits<CharT>;
+  using Chunk = std::pair<const CharT *, const CharT *>;
+
+  const CharT * const text = file.array<CharT>();
+  const CharT * const end = text + file.size<CharT>();
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  std::vector<Chunk> chunks;
+  for( auto first = text; first < end; )
+  {
+    auto last = first + std::min( grain, size_t( end - first ) );
+    while( last < end && !std::isspace( Traits::to_int_type( *last ) ) )
+    {
+      last += 1;
+    }
+    chunks.emplace_back( first, last );
+    first = last;
+  }
+
+  auto counts = pipeline::parallel( std::move( chunks ) )
+    | pipeline::flat_map<Token<CharT>>( []( const Chunk & chunk, auto && emit )
+      {
+        Tokenizer<CharT> tokenizer{ chunk.first, size_t( chunk.second - chunk.first ) };
+        while( !tokenizer.empty() )
+        {
+          emit( tokenizer.next() );
+        }
+      })
+    | pipeline::group_by( []( const Token<CharT> & token ){ return token; }, Freq{}, []( Freq & freq, const Token<CharT> & ){ freq.count += 1; } );
+  counts.run( executor );
+
+  const auto end_time = std::chrono::steady_clock::now();
+  return end_time - begin;
+}
+
 template <typename CharT>
 class Bucket {
  public:
@@ -468,6 +511,18 @@ int main( int argc, char ** argv )
     const auto duration = freq_with_executor2<char>( file, job_multipler, concurrency );
     std::cout << std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() << " usec" << std::endl;
   }
+  {
+    const auto duration = freq_with_executor_adaptive<char>( file, 64 * 1024, concurrency );
+    std::cout << std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() << " usec" << std::endl;
+  }
+  {
+    const auto duration = sketch_with_executor<char>( file, 64 * 1024, concurrency );
+    std::cout << std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() << " usec" << std::endl;
+  }
+  {
+    const auto duration = freq_with_pipeline<char>( file, 64 * 1024, concurrency );
+    std::cout << std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() << " usec" << std::endl;
+  }
   {
     const auto duration = freq_with_threads<char>( file, job_multipler, concurrency );
     std::cout << std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() << " usec" << std::endl;
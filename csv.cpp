@@ -0,0 +1,503 @@
+
+#include <limits>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "include/Executor.h"
+#include "include/mapped_file.h"
+
+using namespace rabid;
+
+using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+
+/// Structural character bitmasks for a 64 byte block.
+///
+/// Bit N of each mask describes byte N of the block.
+///
+struct Masks {
+  std::uint64_t quote;
+  std::uint64_t delimiter;
+  std::uint64_t newline;
+};
+
+/// Classify 64 bytes one at a time.
+///
+inline Masks classify_scalar( const char * block, char delimiter )
+{
+  Masks result{ 0, 0, 0 };
+  for( size_t index = 0; index < 64; ++index )
+  {
+    const auto bit = std::uint64_t{1} << index;
+    result.quote |= ( block[ index ] == '"' ) ? bit : 0;
+    result.delimiter |= ( block[ index ] == delimiter ) ? bit : 0;
+    result.newline |= ( block[ index ] == '\n' ) ? bit : 0;
+  }
+  return result;
+}
+
+#ifdef __SSE2__
+/// Classify 64 bytes as four 16 byte vectors.
+///
+inline Masks classify( const char * block, char delimiter )
+{
+  const auto quote = _mm_set1_epi8( '"' );
+  const auto separator = _mm_set1_epi8( delimiter );
+  const auto newline = _mm_set1_epi8( '\n' );
+
+  Masks result{ 0, 0, 0 };
+  for( unsigned lane = 0; lane < 4; ++lane )
+  {
+    const auto bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block + lane * 16 ) );
+    const auto shift = lane * 16;
+    result.quote |= std::uint64_t( unsigned( _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, quote ) ) ) ) << shift;
+    result.delimiter |= std::uint64_t( unsigned( _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, separator ) ) ) ) << shift;
+    result.newline |= std::uint64_t( unsigned( _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, newline ) ) ) ) << shift;
+  }
+  return result;
+}
+#else
+inline Masks classify( const char * block, char delimiter ) { return classify_scalar( block, delimiter ); }
+#endif
+
+/// Inclusive prefix XOR: bit N is the parity of bits [0,N].
+///
+/// Applied to the quote mask, marks bytes inside quotes (including the
+/// opening quote). Equivalent to a carry-less multiply by all ones.
+///
+inline std::uint64_t prefix_xor( std::uint64_t bits )
+{
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+/// Stage 1 structural indexer over a byte range.
+///
+/// Visits unquoted delimiters and newlines in order. Quoted regions carry
+/// across blocks through the inside flag, which callers seed for ranges that
+/// begin inside a quoted field.
+///
+class Indexer {
+ public:
+  Indexer( const char * begin_arg, const char * end_arg, char delimiter_arg, bool inside_arg )
+  : begin( begin_arg )
+  , end( end_arg )
+  , delimiter( delimiter_arg )
+  , carry( inside_arg ? ~std::uint64_t{0} : 0 )
+  {}
+
+  /// Visit structurals until function( position, newline ) returns false.
+  ///
+  /// @return true if the range was exhausted.
+  ///
+  template < typename Function >
+  bool scan( Function && function )
+  {
+    for( auto block = begin; block < end; block += 64 )
+    {
+      const auto masks = load( block );
+      const auto inside = prefix_xor( masks.quote ) ^ carry;
+      carry = std::uint64_t( std::int64_t( inside ) >> 63 );
+
+      auto structural = ( masks.delimiter | masks.newline ) & ~inside;
+      while( structural )
+      {
+        const auto bit = unsigned( __builtin_ctzll( structural ) );
+        structural &= structural - 1;
+        if( !function( block + bit, ( masks.newline >> bit ) & 1 ) )
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /// Count quotes in a range, i.e. to derive the quote state at its end.
+  ///
+  static size_t quotes( const char * begin, const char * end )
+  {
+    Indexer indexer{ begin, end, '"', false };
+    size_t result = 0;
+    for( auto block = begin; block < end; block += 64 )
+    {
+      result += size_t( __builtin_popcountll( indexer.load( block ).quote ) );
+    }
+    return result;
+  }
+
+ protected:
+  /// Classify a block, padding the final partial block with zeros.
+  ///
+  Masks load( const char * block ) const
+  {
+    if( end - block >= 64 )
+    {
+      return classify( block, delimiter );
+    }
+    char padded[ 64 ] = {};
+    std::memcpy( padded, block, size_t( end - block ) );
+    return classify( padded, delimiter );
+  }
+
+  const char * const begin;
+  const char * const end;
+  const char delimiter;
+  std::uint64_t carry;
+};
+
+/// A raw field, including any quotes and a trailing carriage return.
+///
+struct Field {
+  const char * begin;
+  const char * end;
+};
+
+/// Per-column statistics accumulated by a column's owner.
+///
+struct Summary {
+  size_t fields = 0;
+  size_t bytes = 0;
+  size_t integers = 0;   ///< Fields that parsed as integers.
+  std::int64_t sum = 0;  ///< Sum of integer fields.
+
+  void insert( const Field & field )
+  {
+    auto end = field.end;
+    if( end != field.begin && end[ -1 ] == '\r' )
+    {
+      end -= 1;
+    }
+
+    fields += 1;
+    bytes += size_t( end - field.begin );
+
+    auto current = field.begin;
+    const bool negative = current != end && *current == '-';
+    current += negative;
+    if( current == end )
+    {
+      return;
+    }
+
+    std::int64_t value = 0;
+    for( ; current != end; ++current )
+    {
+      if( *current < '0' || *current > '9' )
+      {
+        return;
+      }
+      value = value * 10 + ( *current - '0' );
+    }
+    integers += 1;
+    sum += negative ? -value : value;
+  }
+
+  friend bool operator == ( const Summary & a, const Summary & b )
+  {
+    return a.fields == b.fields && a.bytes == b.bytes && a.integers == b.integers && a.sum == b.sum;
+  }
+};
+
+/// Split records into fields via the indexer.
+///
+/// Calls function( column, field, newline ) for each field until it returns
+/// false. A newline-terminated field ends at its newline. The final record
+/// need not be newline-terminated.
+///
+template < typename Function >
+void records( const char * begin, const char * end, char delimiter, bool inside, Function && function )
+{
+  auto start = begin;
+  size_t column = 0;
+  const auto exhausted = Indexer{ begin, end, delimiter, inside }.scan( [&]( const char * position, bool newline )
+    {
+      const auto more = function( column, Field{ start, position }, newline );
+      column = newline ? 0 : column + 1;
+      start = position + 1;
+      return more;
+    });
+
+  if( exhausted && start < end )
+  {
+    function( column, Field{ start, end }, true );
+  }
+}
+
+/// Parse a delimited file into columnar batches on executor workers.
+///
+///   1. Each worker counts the quotes in its chunk. A prefix over chunk
+///      parities tells every chunk whether it begins inside a quoted field.
+///   2. Each worker indexes its chunk with SIMD bitmasks. A chunk owns the
+///      records that begin within it: it skips to its first unquoted newline,
+///      and reads past its end to finish its last record.
+///   3. Fields are gathered into per-column batches of rows, and each batch
+///      is sent to the worker owning the column, which summarizes it.
+///
+class Parser {
+ public:
+  Parser( Exec & executor_arg, const MappedFile & file_arg, char delimiter_arg, size_t batch_arg )
+  : executor( executor_arg )
+  , file( file_arg )
+  , delimiter( delimiter_arg )
+  , batch( batch_arg )
+  , chunks( std::make_unique<Chunk[]>( executor.size() ) )
+  , counter( 0 )
+  {
+    // The header defines the columns.
+    //
+    header = text() + file.size<char>();
+    records( text(), header, delimiter, false, [this]( size_t column, const Field & field, bool newline )
+      {
+        columns = column + 1;
+        if( newline )
+        {
+          header = std::min( field.end + 1, header );
+        }
+        return !newline;
+      });
+    summaries = std::make_unique<Summary[]>( columns );
+  }
+
+  size_t width() const { return columns; }
+
+  const Summary & summary( size_t column ) const { return summaries[ column ]; }
+
+  void operator()()
+  {
+    broadcast( [this]( Chunk & chunk )
+      {
+        const auto range = bounds( Exec::current() );
+        chunk.quotes = Indexer::quotes( range.first, range.second );
+        chunk.output.assign( columns, std::vector<Field>{} );
+      });
+
+    bool inside = false;
+    for( size_t index = 0; index < executor.size(); ++index )
+    {
+      chunks[ index ].inside = inside;
+      inside ^= chunks[ index ].quotes & 1;
+    }
+
+    broadcast( [this]( Chunk & chunk )
+      {
+        const auto range = bounds( Exec::current() );
+        const auto end = text() + file.size<char>();
+        if( range.first == range.second )
+        {
+          return;
+        }
+
+        // Skip the record in progress, unless the chunk begins on a record.
+        // A preceding newline only ends a record if it is unquoted.
+        //
+        auto start = range.first;
+        if( start != header && ( chunk.inside || start[ -1 ] != '\n' ) )
+        {
+          records( start, end, delimiter, chunk.inside, [&start,end]( size_t, const Field & field, bool newline )
+            {
+              start = newline ? std::min( field.end + 1, end ) : end;
+              return !newline;
+            });
+        }
+
+        size_t rows = 0;
+        if( start < range.second )
+        {
+          records( start, end, delimiter, false, [&]( size_t column, const Field & field, bool newline )
+            {
+              if( column < columns )
+              {
+                chunk.output[ column ].push_back( field );
+              }
+              if( newline )
+              {
+                if( ++rows == batch )
+                {
+                  flush( chunk );
+                  rows = 0;
+                }
+                return field.end + 1 < range.second;
+              }
+              return true;
+            });
+        }
+        flush( chunk );
+      });
+  }
+
+ protected:
+  struct alignas(64) Chunk {
+    size_t quotes = 0;
+    bool inside = false;
+    std::vector<std::vector<Field>> output;
+  };
+
+  const char * text() const { return file.array<char>(); }
+
+  /// Chunk boundaries, evenly dividing the records after the header.
+  ///
+  std::pair<const char *, const char *> bounds( size_t index ) const
+  {
+    const auto body = size_t( text() + file.size<char>() - header );
+    return { header + body * index / executor.size(), header + body * ( index + 1 ) / executor.size() };
+  }
+
+  size_t owner( size_t column ) const { return column % executor.size(); }
+
+  void flush( Chunk & chunk )
+  {
+    for( size_t column = 0; column < columns; ++column )
+    {
+      if( chunk.output[ column ].empty() )
+      {
+        continue;
+      }
+      counter.increment();
+      Exec::async( owner( column ), [this,column,fields = std::move( chunk.output[ column ] )]
+        {
+          auto & summary = summaries[ column ];
+          for( auto & field : fields )
+          {
+            summary.insert( field );
+          }
+          counter.decrement();
+        });
+      chunk.output[ column ] = std::vector<Field>{};
+      chunk.output[ column ].reserve( batch );
+    }
+  }
+
+  template < typename Function >
+  void broadcast( Function && function )
+  {
+    executor.each( counter, [this,&function]( size_t index ){ function( chunks[ index ] ); } );
+  }
+
+  Exec & executor;
+  const MappedFile & file;
+  const char delimiter;
+  const size_t batch;
+  std::unique_ptr<Chunk[]> chunks;
+  std::unique_ptr<Summary[]> summaries;
+  size_t columns = 0;
+  const char * header = nullptr;
+  rabid::detail::Counter counter;
+};
+
+/// Byte-at-a-time reference parser.
+///
+std::vector<Summary> parse_scalar( const MappedFile & file, char delimiter, size_t columns )
+{
+  std::vector<Summary> result( columns );
+  const auto text = file.array<char>();
+  const auto end = text + file.size<char>();
+
+  auto current = text;
+  while( current != end && *current++ != '\n' ) {}
+
+  bool inside = false;
+  size_t column = 0;
+  auto start = current;
+  for( ; current != end; ++current )
+  {
+    if( *current == '"' )
+    {
+      inside = !inside;
+    }
+    else if( !inside && ( *current == delimiter || *current == '\n' ) )
+    {
+      if( column < columns )
+      {
+        result[ column ].insert( Field{ start, current } );
+      }
+      column = ( *current == '\n' ) ? 0 : column + 1;
+      start = current + 1;
+    }
+  }
+  if( start < end && column < columns )
+  {
+    result[ column ].insert( Field{ start, end } );
+  }
+  return result;
+}
+
+/// Write a synthetic file with integer, decimal and quoted text columns.
+///
+void generate( const char * path, size_t rows, char delimiter )
+{
+  std::ofstream stream{ path };
+  std::mt19937_64 random{ rows };
+  stream << "id" << delimiter << "value" << delimiter << "price" << delimiter << "comment\n";
+  for( size_t row = 0; row < rows; ++row )
+  {
+    stream << row << delimiter << std::int64_t( random() % 2001 ) - 1000 << delimiter
+      << random() % 100 << '.' << random() % 100 << delimiter;
+    switch( random() % 4 )
+    {
+      case 0: stream << "plain"; break;
+      case 1: stream << "\"quoted" << delimiter << " with delimiter\""; break;
+      case 2: stream << "\"multi\nline \"\"escaped\"\"\""; break;
+      default: break;
+    }
+    stream << '\n';
+  }
+}
+
+int main( int argc, char ** argv )
+{
+  if( argc > 1 && std::string{ argv[ 1 ] } == "generate" && argc > 3 )
+  {
+    generate( argv[ 2 ], strtoul( argv[ 3 ], nullptr, 10 ), ( argc > 4 ? argv[ 4 ][ 0 ] : ',' ) );
+    return 0;
+  }
+  if( argc < 2 )
+  {
+    std::cerr << "usage: " << argv[ 0 ] << " <file> [concurrency] [delimiter] [batch]" << std::endl;
+    std::cerr << "       " << argv[ 0 ] << " generate <file> <rows> [delimiter]" << std::endl;
+    return 1;
+  }
+
+  MappedFile file{ argv[ 1 ] };
+  const size_t concurrency = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
+  const char delimiter = ( argc > 3 ? argv[ 3 ][ 0 ] : ',' );
+  const size_t batch = ( argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : 4096 );
+
+  std::cout << "Warmed up: " << file.warm() << std::endl;
+
+  Exec executor{ concurrency };
+  Parser parser{ executor, file, delimiter, batch };
+
+  const auto begin = std::chrono::steady_clock::now();
+  parser();
+  const auto middle = std::chrono::steady_clock::now();
+  const auto reference = parse_scalar( file, delimiter, parser.width() );
+  const auto end = std::chrono::steady_clock::now();
+
+  const auto parallel = std::chrono::duration_cast<std::chrono::microseconds>( middle - begin ).count();
+  const auto scalar = std::chrono::duration_cast<std::chrono::microseconds>( end - middle ).count();
+  std::cout << "executor: " << parallel << " usec, " << double( file.size<char>() ) / double( parallel ) << " MB/s" << std::endl;
+  std::cout << "scalar: " << scalar << " usec, " << double( file.size<char>() ) / double( scalar ) << " MB/s" << std::endl;
+
+  bool match = true;
+  for( size_t column = 0; column < parser.width(); ++column )
+  {
+    const auto & summary = parser.summary( column );
+    std::cout << "column " << column << ": " << summary.fields << " fields, "
+      << summary.integers << " integers, sum " << summary.sum << std::endl;
+    match = match && summary == reference[ column ];
+  }
+  std::cout << ( match ? "matches reference" : "MISMATCH" ) << std::endl;
+  return match ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "include/interconnect.h"
+
+using namespace rabid;
+
+/// Per-sender count of CAS attempts on a buffer head.
+///
+struct alignas(64) Counter {
+  size_t attempts = 0;
+};
+
+/// Prepare functor counting each attempt to insert into a buffer.
+///
+struct Counting {
+  Counter & counter;
+
+  interconnect::Message::PointerType operator() ( const interconnect::Message::PointerType & prior ) const
+  {
+    counter.attempts += 1;
+    return prior;
+  }
+};
+
+/// Measurements for one fan-in layout and sender count.
+///
+struct Report {
+  size_t senders = 0;
+  size_t messages = 0;
+  size_t attempts = 0;
+  double ns = 0;
+};
+
+/// How senders reach the consumer.
+///
+enum class Layout {
+  shared,     ///< Every sender inserts into one buffer.
+  combining,  ///< Senders deposit in slots, an elected combiner splices them.
+  direct,     ///< Every sender owns a buffer, the consumer sweeps them all.
+};
+
+/// Send messages from many threads to one consumer.
+///
+/// Each sender inserts its messages one at a time while the consumer drains
+/// until all arrive. Attempts counts CAS attempts on the buffer heads senders
+/// insert into, so attempts per message above one are retries.
+///
+/// @param layout How senders reach the consumer.
+/// @param senders Number of sending threads.
+/// @param messages Number of messages sent per thread.
+///
+Report fanin( Layout layout, size_t senders, size_t messages )
+{
+  using clock = std::chrono::steady_clock;
+
+  const auto buffers = std::make_unique<interconnect::Buffer[]>( senders );
+  interconnect::Buffer & destination = buffers[ 0 ];
+  interconnect::Combining combining{ destination, senders };
+
+  std::vector<std::vector<interconnect::Message>> pools( senders );
+  for( auto & pool : pools )
+  {
+    pool.assign( messages, interconnect::Message{ 0 } );
+  }
+  std::vector<Counter> counters( senders );
+  std::atomic<bool> go{ false };
+
+  std::vector<std::thread> threads;
+  for( size_t sender = 0; sender < senders; ++sender )
+  {
+    threads.emplace_back( [&,sender]
+      {
+        while( !go.load( std::memory_order_acquire ) ) {}
+        Counting counting{ counters[ sender ] };
+        for( auto & message : pools[ sender ] )
+        {
+          const interconnect::Message::PointerType pointer{ &message };
+          switch( layout )
+          {
+            case Layout::shared: destination.insert( pointer, counting ); break;
+            case Layout::combining: combining.send( sender, pointer, counting ); break;
+            case Layout::direct: buffers[ sender ].insert( pointer, counting ); break;
+          }
+        }
+      });
+  }
+
+  const auto total = senders * messages;
+  const size_t sources = ( layout == Layout::direct ? senders : 1 );
+  size_t received = 0;
+  const auto begin = clock::now();
+  go.store( true, std::memory_order_release );
+  while( received < total )
+  {
+    for( size_t source = 0; source < sources; ++source )
+    {
+      auto batch = buffers[ source ].clear();
+      while( !batch.empty() )
+      {
+        batch.remove();
+        received += 1;
+      }
+    }
+  }
+  const auto end = clock::now();
+
+  for( auto & thread : threads )
+  {
+    thread.join();
+  }
+
+  Report report;
+  report.senders = senders;
+  report.messages = total;
+  for( auto & counter : counters )
+  {
+    report.attempts += counter.attempts;
+  }
+  report.ns = double( std::chrono::duration_cast<std::chrono::nanoseconds>( end - begin ).count() ) / double( total );
+  return report;
+}
+
+std::ostream & header( std::ostream & stream )
+{
+  return stream << std::setw( 10 ) << "layout"
+    << std::setw( 9 ) << "senders"
+    << std::setw( 12 ) << "messages"
+    << std::setw( 10 ) << "cas/msg"
+    << std::setw( 10 ) << "ns/msg" << std::endl;
+}
+
+std::ostream & operator << ( std::ostream & stream, const Report & report )
+{
+  return stream << std::setw( 9 ) << report.senders
+    << std::setw( 12 ) << report.messages
+    << std::setw( 10 ) << std::fixed << std::setprecision( 3 ) << double( report.attempts ) / double( report.messages )
+    << std::setw( 10 ) << std::setprecision( 1 ) << report.ns;
+}
+
+int main( int argc, char ** argv )
+{
+  const size_t max_senders = ( argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
+  const size_t messages = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 100000 );
+
+  header( std::cout );
+  for( size_t senders = 1; senders <= max_senders; senders *= 2 )
+  {
+    std::cout << std::setw( 10 ) << "shared" << fanin( Layout::shared, senders, messages ) << std::endl;
+    std::cout << std::setw( 10 ) << "combining" << fanin( Layout::combining, senders, messages ) << std::endl;
+    std::cout << std::setw( 10 ) << "direct" << fanin( Layout::direct, senders, messages ) << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,174 @@
+
+#include <limits>
+#include <iostream>
+#include <chrono>
+
+#include "include/Executor.h"
+
+using namespace rabid;
+
+using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+
+struct Zero {
+  int operator()() const { return 0; }
+};
+
+struct Increment {
+  int operator()( int value ) const { return value + 1; }
+};
+
+/// Node sizes for a future's dispatch type.
+///
+template < typename Future >
+struct Nodes;
+
+template < typename Value, typename Dispatch >
+struct Nodes<Future<Value,Dispatch>> {
+  static constexpr size_t argument = sizeof( detail::expression::Argument<Dispatch,Value> );
+  static constexpr size_t continuation = sizeof( detail::expression::Continuation<Dispatch,Increment,Value,Value> );
+};
+
+using Clock = std::chrono::steady_clock;
+
+/// Print nanoseconds per continuation.
+///
+void report( const char * name, size_t parameter, Clock::duration duration, size_t continuations )
+{
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>( duration ).count();
+  std::cout << name << " " << parameter << ": " << double( ns ) / double( continuations ) << " ns/continuation" << std::endl;
+}
+
+/// Chain depth continuations off a promise, then complete it.
+///
+/// Chained evaluation recurses through ImmediateDispatch, so depth is bounded
+/// by the stack.
+///
+Clock::duration chain( size_t depth, size_t repeats, bool before )
+{
+  const auto begin = Clock::now();
+  int sink = 0;
+  for( size_t repeat = 0; repeat < repeats; ++repeat )
+  {
+    Promise<int> promise;
+    if( !before )
+    {
+      promise.complete( 0 );
+    }
+
+    auto future = promise.then( Increment{} );
+    for( size_t index = 1; index < depth; ++index )
+    {
+      future = future.then( Increment{} );
+    }
+    future.then( [&sink]( int value ){ sink += value; } );
+
+    if( before )
+    {
+      promise.complete( 0 );
+    }
+  }
+  const auto end = Clock::now();
+  if( sink != int( ( depth ) * repeats ) )
+  {
+    std::cerr << "chain produced " << sink << std::endl;
+  }
+  return end - begin;
+}
+
+/// Attach width continuations to a single promise, then complete it.
+///
+Clock::duration fan_out( size_t width, size_t repeats )
+{
+  const auto begin = Clock::now();
+  int sink = 0;
+  for( size_t repeat = 0; repeat < repeats; ++repeat )
+  {
+    Promise<int> promise;
+    for( size_t index = 0; index < width; ++index )
+    {
+      promise.then( [&sink]( int value ){ sink += value; } );
+    }
+    promise.complete( 1 );
+  }
+  const auto end = Clock::now();
+  if( sink != int( width * repeats ) )
+  {
+    std::cerr << "fan out produced " << sink << std::endl;
+  }
+  return end - begin;
+}
+
+/// Chain depth continuations in an Executor, each hopping stride workers.
+///
+/// A stride of zero keeps every continuation on the originating worker,
+/// measuring TaskDispatch without cross-worker traffic.
+///
+Clock::duration dispatched( Exec & executor, size_t depth, size_t repeats, size_t stride )
+{
+  rabid::detail::Join join{ ssize_t( repeats ) };
+  const auto begin = Clock::now();
+
+  executor.wake();
+  executor.inject( 0, [&join,depth,repeats,stride]
+    {
+      for( size_t repeat = 0; repeat < repeats; ++repeat )
+      {
+        auto future = Exec::async( Exec::current(), Zero{} );
+        size_t target = Exec::current();
+        for( size_t index = 0; index < depth; ++index )
+        {
+          target = ( target + stride ) % Exec::concurrency();
+          future = future.then( target, Increment{} );
+        }
+        future.then( [&join,depth]( int value )
+          {
+            if( value != int( depth ) )
+            {
+              std::cerr << "dispatch produced " << value << std::endl;
+            }
+            join.notify();
+          });
+      }
+    });
+
+  join.wait();
+  const auto end = Clock::now();
+  return end - begin;
+}
+
+int main( int argc, char ** argv )
+{
+  const size_t continuations = ( argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 1 << 18 );
+  const size_t concurrency = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
+
+  using Immediate = Nodes<Future<int>>;
+  using Dispatched = Nodes<decltype( Exec::async( 0, Zero{} ) )>;
+  std::cout << "immediate: " << Immediate::argument << " bytes/promise, " << Immediate::continuation << " bytes/continuation" << std::endl;
+  std::cout << "dispatched: " << Dispatched::continuation << " bytes/continuation" << std::endl;
+
+  for( size_t depth = 1; depth <= 1024; depth *= 4 )
+  {
+    report( "chain before complete, depth", depth, chain( depth, continuations / depth, true ), continuations / depth * depth );
+    report( "chain after complete, depth", depth, chain( depth, continuations / depth, false ), continuations / depth * depth );
+  }
+
+  for( size_t width = 1; width <= 1024; width *= 4 )
+  {
+    report( "fan out, width", width, fan_out( width, continuations / width ), continuations / width * width );
+  }
+
+  Exec executor{ concurrency };
+  for( size_t depth = 1; depth <= 1024; depth *= 4 )
+  {
+    report( "task dispatch, depth", depth, dispatched( executor, depth, continuations / depth, 0 ), continuations / depth * depth );
+  }
+  if( concurrency > 1 )
+  {
+    for( size_t depth = 1; depth <= 1024; depth *= 4 )
+    {
+      report( "cross-worker hops, depth", depth, dispatched( executor, depth, continuations / depth, 1 ), continuations / depth * depth );
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,646 @@
+
+#include <limits>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <deque>
+#include <array>
+
+#include "include/Executor.h"
+
+using namespace rabid;
+
+using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+using Vertex = std::uint32_t;
+using Edge = std::pair<Vertex,Vertex>;
+
+/// Generate an RMAT (recursive matrix) edge list with 2^scale vertices.
+///
+/// Uses the Graph500 quadrant probabilities. Vertex ids are permuted so that
+/// high degree vertices are not clustered at low ids.
+///
+std::vector<Edge> rmat( size_t scale, size_t edge_factor, std::uint64_t seed = 1 )
+{
+  const double a = 0.57, b = 0.19, c = 0.19;
+  const size_t vertices = size_t{1} << scale;
+
+  std::mt19937_64 random{ seed };
+  std::uniform_real_distribution<double> uniform;
+
+  std::vector<Vertex> permutation( vertices );
+  std::iota( permutation.begin(), permutation.end(), Vertex{0} );
+  std::shuffle( permutation.begin(), permutation.end(), random );
+
+  std::vector<Edge> edges;
+  edges.reserve( vertices * edge_factor );
+  for( size_t edge = 0; edge < vertices * edge_factor; ++edge )
+  {
+    size_t src = 0, dst = 0;
+    for( size_t bit = 0; bit < scale; ++bit )
+    {
+      const auto r = uniform( random );
+      if( r >= a + b + c )
+      {
+        src |= size_t{1} << bit;
+        dst |= size_t{1} << bit;
+      }
+      else if( r >= a + b )
+      {
+        src |= size_t{1} << bit;
+      }
+      else if( r >= a )
+      {
+        dst |= size_t{1} << bit;
+      }
+    }
+    edges.emplace_back( permutation[ src ], permutation[ dst ] );
+  }
+  return edges;
+}
+
+/// Undirected graph partitioned by vertex across workers.
+///
+/// Worker W owns every vertex V where V % workers == W, and holds those
+/// vertices' adjacency as a CSR (compressed sparse row) shard.
+///
+class Graph {
+ public:
+  struct Shard {
+    std::vector<size_t> offsets;
+    std::vector<Vertex> targets;
+
+    size_t size() const { return offsets.size() - 1; }
+    size_t degree( size_t local ) const { return offsets[ local + 1 ] - offsets[ local ]; }
+    const Vertex * begin( size_t local ) const { return targets.data() + offsets[ local ]; }
+    const Vertex * end( size_t local ) const { return targets.data() + offsets[ local + 1 ]; }
+  };
+
+  Graph( size_t vertices_arg, const std::vector<Edge> & edges, size_t workers )
+  : vertices( vertices_arg )
+  , shards( workers )
+  {
+    for( size_t owner = 0; owner < workers; ++owner )
+    {
+      shards[ owner ].offsets.assign( ( vertices - owner + workers - 1 ) / workers + 1, 0 );
+    }
+
+    for( auto & edge : edges )
+    {
+      if( edge.first != edge.second )
+      {
+        shards[ owner( edge.first ) ].offsets[ local( edge.first ) + 1 ] += 1;
+        shards[ owner( edge.second ) ].offsets[ local( edge.second ) + 1 ] += 1;
+      }
+    }
+
+    for( auto & shard : shards )
+    {
+      std::partial_sum( shard.offsets.begin(), shard.offsets.end(), shard.offsets.begin() );
+      shard.targets.resize( shard.offsets.back() );
+    }
+
+    std::vector<std::vector<size_t>> cursor( workers );
+    for( size_t owner = 0; owner < workers; ++owner )
+    {
+      cursor[ owner ].assign( shards[ owner ].offsets.begin(), shards[ owner ].offsets.end() - 1 );
+    }
+
+    const auto insert = [&]( Vertex src, Vertex dst )
+    {
+      shards[ owner( src ) ].targets[ cursor[ owner( src ) ][ local( src ) ]++ ] = dst;
+    };
+
+    for( auto & edge : edges )
+    {
+      if( edge.first != edge.second )
+      {
+        insert( edge.first, edge.second );
+        insert( edge.second, edge.first );
+      }
+    }
+  }
+
+  size_t size() const { return vertices; }
+  size_t edges() const
+  {
+    size_t result = 0;
+    for( auto & shard : shards )
+    {
+      result += shard.targets.size();
+    }
+    return result;
+  }
+
+  size_t owner( Vertex vertex ) const { return vertex % shards.size(); }
+  size_t local( Vertex vertex ) const { return vertex / shards.size(); }
+  Vertex global( size_t owner, size_t local ) const { return Vertex( local * shards.size() + owner ); }
+  const Shard & shard( size_t owner ) const { return shards[ owner ]; }
+
+  /// Query the vertex with the most edges.
+  ///
+  Vertex hub() const
+  {
+    Vertex result = 0;
+    size_t degree = 0;
+    for( size_t owner = 0; owner < shards.size(); ++owner )
+    {
+      for( size_t local = 0; local < shards[ owner ].size(); ++local )
+      {
+        if( shards[ owner ].degree( local ) > degree )
+        {
+          degree = shards[ owner ].degree( local );
+          result = global( owner, local );
+        }
+      }
+    }
+    return result;
+  }
+
+ protected:
+  size_t vertices;
+  std::vector<Shard> shards;
+};
+
+/// Owner-computes engine for vertex programs.
+///
+/// Vertex state is only read or written by the worker owning the vertex.
+/// An active vertex emits one value along each of its edges; values bound for
+/// other workers are batched per destination and delivered as a single task
+/// to the owner.
+///
+/// Programs provide:
+///   - State: per-vertex state type.
+///   - Value: message type.
+///   - bool initial( vertex, state ): initialize state, returning if active.
+///   - bool receive( state, value ): fold a value, returning if (re)activated.
+///   - Value emit( state, degree ): produce the value sent along each edge.
+///
+/// Two modes are supported:
+///   - synchronous(): bulk-synchronous supersteps. Values sent during a
+///     superstep, including those for the current worker, are staged by
+///     superstep parity and folded at the start of the next one, so no vertex
+///     sees a value from the superstep it is emitting in.
+///   - asynchronous(): values are folded as they arrive, and activated
+///     vertices processed soon after, until no messages remain in flight.
+///
+template < typename Program >
+class Engine {
+ public:
+  using State = typename Program::State;
+  using Value = typename Program::Value;
+
+  Engine( Exec & executor_arg, const Graph & graph_arg, Program program_arg, size_t batch_arg = 1024 )
+  : executor( executor_arg )
+  , graph( graph_arg )
+  , program( program_arg )
+  , batch( batch_arg )
+  , partitions( std::make_unique<Partition[]>( executor.size() ) )
+  , counter( 0 )
+  {
+    broadcast( [this]( Partition & partition )
+      {
+        const auto & shard = graph.shard( Exec::current() );
+        partition.state.resize( shard.size() );
+        partition.flagged.assign( shard.size(), false );
+        partition.outbox.resize( Exec::concurrency() );
+        for( size_t local = 0; local < shard.size(); ++local )
+        {
+          if( program.initial( graph.global( Exec::current(), local ), partition.state[ local ] ) )
+          {
+            activate( partition, local );
+          }
+        }
+      });
+  }
+
+  /// Run supersteps until no vertex is active.
+  ///
+  /// @return number of supersteps in which some vertex was active.
+  ///
+  size_t synchronous( size_t limit = std::numeric_limits<size_t>::max() )
+  {
+    size_t steps = 0;
+    while( steps < limit && active() )
+    {
+      broadcast( [this]( Partition & partition )
+        {
+          // Fold values sent during the previous superstep.
+          //
+          auto & arrived = partition.staged[ ( step + 1 ) % 2 ];
+          for( auto & update : arrived )
+          {
+            fold( partition, graph.local( update.vertex ), update.value );
+          }
+          arrived.clear();
+
+          partition.frontier.swap( partition.next );
+          partition.next.clear();
+          for( auto local : partition.frontier )
+          {
+            partition.flagged[ local ] = false;
+            scatter( partition, local );
+          }
+          flush( partition );
+        });
+      step += 1;
+
+      for( size_t owner = 0; owner < executor.size(); ++owner )
+      {
+        if( !partitions[ owner ].frontier.empty() )
+        {
+          steps += 1;
+          break;
+        }
+      }
+    }
+    return steps;
+  }
+
+  /// Process vertices as they activate until quiescent.
+  ///
+  /// @return number of passes over activated vertices, across all workers.
+  ///
+  size_t asynchronous()
+  {
+    eager = true;
+    broadcast( [this]( Partition & partition )
+      {
+        drain( partition );
+      });
+    eager = false;
+
+    size_t passes = 0;
+    for( size_t owner = 0; owner < executor.size(); ++owner )
+    {
+      passes += partitions[ owner ].passes;
+    }
+    return passes;
+  }
+
+  /// Visit the state of each vertex. Only valid while the engine is idle.
+  ///
+  template < typename Function >
+  void each( Function && function ) const
+  {
+    for( size_t owner = 0; owner < executor.size(); ++owner )
+    {
+      const auto & state = partitions[ owner ].state;
+      for( size_t local = 0; local < state.size(); ++local )
+      {
+        function( graph.global( owner, local ), state[ local ] );
+      }
+    }
+  }
+
+ protected:
+  struct Update {
+    Vertex vertex;
+    Value value;
+  };
+
+  /// Vertex state owned by a single worker.
+  ///
+  struct alignas(64) Partition {
+    std::vector<State> state;
+    std::vector<bool> flagged;
+    std::deque<size_t> frontier;
+    std::deque<size_t> next;
+    std::vector<std::vector<Update>> outbox;
+    std::array<std::vector<Update>,2> staged;  ///< Synchronous values, by superstep parity.
+    size_t passes = 0;
+    bool scheduled = false;
+  };
+
+  /// Task folding a batch of values into the recipient's partition.
+  ///
+  struct Deliver {
+    Engine & engine;
+    std::vector<Update> updates;
+
+    void operator() ()
+    {
+      auto & partition = engine.partitions[ Exec::current() ];
+      if( engine.eager )
+      {
+        for( auto & update : updates )
+        {
+          engine.fold( partition, engine.graph.local( update.vertex ), update.value );
+        }
+        engine.schedule( partition );
+      }
+      else
+      {
+        auto & staged = partition.staged[ engine.step % 2 ];
+        staged.insert( staged.end(), updates.begin(), updates.end() );
+      }
+      engine.counter.decrement();
+    }
+  };
+
+  /// Task processing a partition's active vertices.
+  ///
+  struct Drain {
+    Engine & engine;
+
+    void operator() ()
+    {
+      auto & partition = engine.partitions[ Exec::current() ];
+      partition.scheduled = false;
+      engine.drain( partition );
+      engine.counter.decrement();
+    }
+  };
+
+  /// Run the function on every worker's partition, waiting for all messages.
+  ///
+  template < typename Function >
+  void broadcast( Function && function )
+  {
+    executor.each( counter, [this,&function]( size_t index ){ function( partitions[ index ] ); } );
+  }
+
+  bool active() const
+  {
+    for( size_t owner = 0; owner < executor.size(); ++owner )
+    {
+      const auto & partition = partitions[ owner ];
+      if( !partition.next.empty() || !partition.staged[ 0 ].empty() || !partition.staged[ 1 ].empty() )
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void activate( Partition & partition, size_t local )
+  {
+    if( !partition.flagged[ local ] )
+    {
+      partition.flagged[ local ] = true;
+      partition.next.push_back( local );
+    }
+  }
+
+  void fold( Partition & partition, size_t local, const Value & value )
+  {
+    if( program.receive( partition.state[ local ], value ) )
+    {
+      activate( partition, local );
+    }
+  }
+
+  void scatter( Partition & partition, size_t local )
+  {
+    const auto & shard = graph.shard( Exec::current() );
+    const auto value = program.emit( partition.state[ local ], shard.degree( local ) );
+    for( auto target = shard.begin( local ); target != shard.end( local ); ++target )
+    {
+      const auto owner = graph.owner( *target );
+      if( owner == Exec::current() && eager )
+      {
+        fold( partition, graph.local( *target ), value );
+      }
+      else if( owner == Exec::current() )
+      {
+        partition.staged[ step % 2 ].push_back( Update{ *target, value } );
+      }
+      else
+      {
+        auto & outbox = partition.outbox[ owner ];
+        outbox.push_back( Update{ *target, value } );
+        if( outbox.size() >= batch )
+        {
+          send( partition, owner );
+        }
+      }
+    }
+  }
+
+  void drain( Partition & partition )
+  {
+    partition.passes += 1;
+    while( !partition.next.empty() )
+    {
+      const auto local = partition.next.front();
+      partition.next.pop_front();
+      partition.flagged[ local ] = false;
+      scatter( partition, local );
+    }
+    flush( partition );
+  }
+
+  /// Schedule processing of active vertices after pending deliveries.
+  ///
+  /// Drains are posted behind the worker's inbound messages rather than run
+  /// per delivery, so values arriving together are folded before vertices
+  /// emit. That keeps asynchronous mode from pushing once per value.
+  ///
+  void schedule( Partition & partition )
+  {
+    if( !partition.scheduled && !partition.next.empty() )
+    {
+      partition.scheduled = true;
+      counter.increment();
+      Exec::async( Exec::current(), Drain{ *this } );
+    }
+  }
+
+  void send( Partition & partition, size_t owner )
+  {
+    counter.increment();
+    Exec::async( owner, Deliver{ *this, std::move( partition.outbox[ owner ] ) } );
+    partition.outbox[ owner ] = std::vector<Update>{};
+    partition.outbox[ owner ].reserve( batch );
+  }
+
+  void flush( Partition & partition )
+  {
+    for( size_t owner = 0; owner < partition.outbox.size(); ++owner )
+    {
+      if( !partition.outbox[ owner ].empty() )
+      {
+        send( partition, owner );
+      }
+    }
+  }
+
+  Exec & executor;
+  const Graph & graph;
+  const Program program;
+  const size_t batch;
+  std::unique_ptr<Partition[]> partitions;
+  rabid::detail::Counter counter;
+  bool eager = false;   ///< Deliveries process activated vertices immediately.
+  size_t step = 0;      ///< Current superstep, selecting where values are staged.
+};
+
+/// Breadth-first search: state is the distance from the root.
+///
+struct BreadthFirst {
+  using State = std::uint32_t;
+  using Value = std::uint32_t;
+  static constexpr State unreached = std::numeric_limits<State>::max();
+
+  Vertex root;
+
+  bool initial( Vertex vertex, State & state ) const
+  {
+    state = ( vertex == root ? 0 : unreached );
+    return vertex == root;
+  }
+
+  bool receive( State & state, const Value & value ) const
+  {
+    if( value < state )
+    {
+      state = value;
+      return true;
+    }
+    return false;
+  }
+
+  Value emit( State & state, size_t ) const { return state + 1; }
+};
+
+/// Connected components via label propagation: state is the minimum vertex id
+/// reachable.
+///
+struct Components {
+  using State = Vertex;
+  using Value = Vertex;
+
+  bool initial( Vertex vertex, State & state ) const
+  {
+    state = vertex;
+    return true;
+  }
+
+  bool receive( State & state, const Value & value ) const
+  {
+    if( value < state )
+    {
+      state = value;
+      return true;
+    }
+    return false;
+  }
+
+  Value emit( State & state, size_t ) const { return state; }
+};
+
+/// PageRank via residual (delta) pushing.
+///
+/// Each vertex accumulates incoming rank as a residual, and becomes active
+/// once the residual exceeds epsilon. Emitting moves the residual into the
+/// vertex's rank and pushes the damped share to each neighbor.
+///
+struct PageRank {
+  struct State {
+    double rank;
+    double residual;
+  };
+  using Value = double;
+
+  double damping;
+  double epsilon;
+  size_t vertices;
+
+  bool initial( Vertex, State & state ) const
+  {
+    state.rank = 0;
+    state.residual = ( 1.0 - damping ) / double( vertices );
+    return true;
+  }
+
+  bool receive( State & state, const Value & value ) const
+  {
+    state.residual += value;
+    return state.residual > epsilon;
+  }
+
+  Value emit( State & state, size_t degree ) const
+  {
+    const auto residual = state.residual;
+    state.rank += residual;
+    state.residual = 0;
+    return degree ? damping * residual / double( degree ) : 0.0;
+  }
+};
+
+/// Time a single engine run.
+///
+/// @param unit Name of the count returned by run.
+///
+template < typename Program, typename Run, typename Summary >
+void benchmark( const char * name, const char * unit, Exec & executor, const Graph & graph, const Program & program, size_t batch, Run && run, Summary && summary )
+{
+  Engine<Program> engine{ executor, graph, program, batch };
+  const auto begin = std::chrono::steady_clock::now();
+  const auto count = run( engine );
+  const auto end = std::chrono::steady_clock::now();
+  std::cout << name << ": "
+    << std::chrono::duration_cast<std::chrono::microseconds>( end - begin ).count() << " usec, "
+    << count << " " << unit << ", ";
+  summary( engine );
+  std::cout << std::endl;
+}
+
+int main( int argc, char ** argv )
+{
+  const size_t scale = ( argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 16 );
+  const size_t edge_factor = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 16 );
+  const size_t concurrency = ( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
+  const size_t batch = ( argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : 1024 );
+
+  const Graph graph{ size_t{1} << scale, rmat( scale, edge_factor ), concurrency };
+  std::cout << "RMAT scale " << scale << ": " << graph.size() << " vertices, " << graph.edges() / 2 << " edges" << std::endl;
+
+  Exec executor{ concurrency };
+
+  const auto synchronous = []( auto & engine ) { return engine.synchronous(); };
+  const auto asynchronous = []( auto & engine ) { return engine.asynchronous(); };
+
+  const auto reached = []( auto & engine )
+  {
+    size_t count = 0;
+    BreadthFirst::State depth = 0;
+    engine.each( [&]( Vertex, BreadthFirst::State state )
+      {
+        if( state != BreadthFirst::unreached )
+        {
+          count += 1;
+          depth = std::max( depth, state );
+        }
+      });
+    std::cout << count << " reached, depth " << depth;
+  };
+
+  const auto components = []( auto & engine )
+  {
+    size_t count = 0;
+    engine.each( [&]( Vertex vertex, Vertex label ) { count += ( vertex == label ); } );
+    std::cout << count << " components";
+  };
+
+  const auto rank = []( auto & engine )
+  {
+    double total = 0;
+    engine.each( [&]( Vertex, const PageRank::State & state ) { total += state.rank; } );
+    std::cout << "rank sum " << total;
+  };
+
+  const BreadthFirst bfs{ graph.hub() };
+  const Components cc{};
+  const PageRank pagerank{ 0.85, 1e-4 / double( graph.size() ), graph.size() };
+
+  benchmark( "bfs bsp", "supersteps", executor, graph, bfs, batch, synchronous, reached );
+  benchmark( "bfs async", "passes", executor, graph, bfs, batch, asynchronous, reached );
+  benchmark( "cc bsp", "supersteps", executor, graph, cc, batch, synchronous, components );
+  benchmark( "cc async", "passes", executor, graph, cc, batch, asynchronous, components );
+  benchmark( "pagerank bsp", "supersteps", executor, graph, pagerank, batch, synchronous, rank );
+  benchmark( "pagerank async", "passes", executor, graph, pagerank, batch, asynchronous, rank );
+
+  return 0;
+}
@@ -2,10 +2,25 @@
 
 #include "interconnect.h"
 #include "future.h"
+#include "accounting.h"
+#include "stats.h"
+#include "probes.h"
+#include "detail/arena.h"
 
+#include <algorithm>
 #include <thread>
+#include <chrono>
+#include <cstddef>
 #include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace rabid {
 
@@ -22,6 +37,11 @@ namespace rabid {
     /// via idle.interrupt(). Idle::interrupt() should wake the next(including
     /// current) yield attempt.
     ///
+    /// Idle::running() reports if the worker should keep running, so optional
+    /// work (such as background slices) can stop before the next yield.
+    /// Idle::yield( timeout ) is like yield(), but returns after at most
+    /// timeout even if not interrupted.
+    ///
     /// TODO: At some point it would be nice to have an indication of how many
     /// threads are running, to enable "Executor::wait()" style blocking until
     /// all threads are idle. However, this has so far proven non-trivial to
@@ -42,8 +62,14 @@ namespace rabid {
       /// Otherwise, the mutex synchronizes behavior around sleeping and waking
       /// the condition variable.
       ///
-      /// In addition to required yield() and interrupt() behavior, enabled() is
-      /// also implemented to stop threads.
+      /// In addition to required yield(), interrupt() and running() behavior,
+      /// enable() is also implemented to stop threads.
+      ///
+      /// Wait objects may also be arranged in a tree via adopt() so that a
+      /// burst of work can wake every thread with broadcast(): each thread
+      /// woken by a broadcast wakes its children before returning from yield,
+      /// so waking N threads takes O(log N) latency instead of one caller
+      /// paying for N sequential wakes.
       ///
       class Wait {
        public:
@@ -54,16 +80,17 @@ namespace rabid {
         ///
         bool yield()
         {
-          std::unique_lock<std::mutex> lock{ mutex };
-          if( enabled )
-          {
-            if( armed.load( std::memory_order_relaxed ) )
-            {
-              condition.wait( lock );
-            }
-            armed.store( true, std::memory_order_relaxed );
-          }
-          return enabled;
+          return sleep( [this]( std::unique_lock<std::mutex> & lock ){ condition.wait( lock ); } );
+        }
+
+        /// Yield control per API, sleeping at most timeout.
+        ///
+        /// @return boolean indication of if worker may continue to run.
+        ///
+        template < typename Rep, typename Period >
+        bool yield( const std::chrono::duration<Rep,Period> & timeout )
+        {
+          return sleep( [this,&timeout]( std::unique_lock<std::mutex> & lock ){ condition.wait_for( lock, timeout ); } );
         }
 
         /// Interrupt the current or next attempt to yield.
@@ -89,16 +116,113 @@ namespace rabid {
         void enable( bool value )
         {
           std::unique_lock<std::mutex> lock{ mutex };
-          enabled = value;
+          enabled.store( value, std::memory_order_relaxed );
           lock.unlock();
           condition.notify_one();
         }
 
+        /// Query if the worker may continue to run.
+        ///
+        bool running() const { return enabled.load( std::memory_order_relaxed ); }
+
+        /// Set the children woken by broadcasts to this object.
+        ///
+        void adopt( Wait * first, Wait * second )
+        {
+          children[ 0 ] = first;
+          children[ 1 ] = second;
+        }
+
+        /// Interrupt this and all descendant yield attempts.
+        ///
+        /// A sleeping thread relays the broadcast to its children itself once
+        /// woken. If the thread is awake, the caller relays on its behalf
+        /// rather than waiting for the thread's next yield. The propagate flag
+        /// is claimed by exchange, so exactly one party relays.
+        ///
+        void broadcast()
+        {
+          propagate.store( true );
+          interrupt();
+          if( !sleeping.load() )
+          {
+            relay();
+          }
+        }
+
        protected:
+        /// Sleep via the given wait unless interrupted or disabled.
+        ///
+        template < typename Sleep >
+        bool sleep( Sleep && wait )
+        {
+          std::unique_lock<std::mutex> lock{ mutex };
+          if( enabled.load( std::memory_order_relaxed ) )
+          {
+            if( armed.load( std::memory_order_relaxed ) )
+            {
+              sleeping.store( true );
+              wait( lock );
+              sleeping.store( false );
+            }
+            armed.store( true, std::memory_order_relaxed );
+          }
+
+          // Re-read after waking, so a worker woken by enable( false ) exits.
+          //
+          const bool result = enabled.load( std::memory_order_relaxed );
+          lock.unlock();
+          relay();
+          return result;
+        }
+
+        /// Forward a pending broadcast to children.
+        ///
+        void relay()
+        {
+          if( propagate.exchange( false ) )
+          {
+            for( auto child : children )
+            {
+              if( child )
+              {
+                child->broadcast();
+              }
+            }
+          }
+        }
+
         std::atomic<bool> armed{true};      ///< Is thread allowed to sleep.
+        std::atomic<bool> sleeping{false};  ///< Is thread waiting on condition.
+        std::atomic<bool> propagate{false}; ///< Pending broadcast to relay.
         std::mutex mutex;                   ///< Synchronizes condition var.
         std::condition_variable condition;  ///< Sleep/wakeup.
-        bool enabled = true;                ///< Thread enabled status.
+        std::atomic<bool> enabled{true};    ///< Thread enabled status.
+        Wait * children[ 2 ] = {};          ///< Broadcast tree children.
+      };
+
+      /// Implementation of idle that never sleeps.
+      ///
+      /// Used when a worker processes messages from within a task (i.e. while
+      /// joining nested work), where suspending the thread is not an option.
+      ///
+      class Spin {
+       public:
+        bool yield()
+        {
+          std::this_thread::yield();
+          return true;
+        }
+
+        template < typename Rep, typename Period >
+        bool yield( const std::chrono::duration<Rep,Period> & )
+        {
+          return yield();
+        }
+
+        void interrupt() {}
+
+        bool running() const { return true; }
       };
     }
 
@@ -172,20 +296,19 @@ namespace rabid {
 
       /// Suspend execution until there are no pending events.
       ///
+      /// Writes made before each decrement() are visible once wait() returns.
+      ///
       void wait()
       {
         std::unique_lock<std::mutex> lock{ mutex };
-        if( count.load( std::memory_order_relaxed ) )
-        {
-          condition.wait( lock );
-        }
+        condition.wait( lock, [this]{ return count.load( std::memory_order_acquire ) == 0; } );
       }
 
       /// Decrement then number of pending events.
       ///
       void decrement()
       {
-        if( count.fetch_sub( 1, std::memory_order_relaxed ) == 1 )
+        if( count.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
         {
           mutex.lock();
           mutex.unlock();
@@ -225,13 +348,294 @@ namespace rabid {
   ///
   namespace execution {
 
+    /// Process-wide registry of parked threads that ThreadModel borrows.
+    ///
+    /// A borrowed thread runs one job, then parks until the next lease
+    /// instead of exiting. Leases prefer the thread last leased at the same
+    /// worker index, so executors created in sequence reuse threads without
+    /// spawning.
+    ///
+    /// Pins are kept per worker index: a thread stays pinned while parked,
+    /// and whichever thread is leased at an index is re-pinned (or reset to
+    /// its default affinity) to match that index's pin.
+    ///
+    /// The registry is never destroyed, since a leased thread (i.e. of an
+    /// executor alive across std::exit()) may still use it while the process
+    /// exits. Threads parked at exit are stopped and joined.
+    ///
+    class Registry {
+     protected:
+      struct Slot;
+
+     public:
+      /// Job running on a borrowed thread.
+      ///
+      /// Destroying a lease blocks until its job returns, like a join.
+      ///
+      class Lease {
+       public:
+        /// Run job on a registry thread, spawning one if none are parked.
+        ///
+        /// @param index_arg Worker index used to prefer the same thread as before.
+        /// @param job Functor to run.
+        ///
+        Lease( size_t index_arg, std::function<void()> job )
+        : index( index_arg )
+        , slot( instance().borrow( index_arg, std::move( job ), *this ) )
+        {}
+
+        Lease( const Lease & ) = delete;
+        Lease & operator = ( const Lease & ) = delete;
+
+        /// Block until the job returns.
+        ///
+        void wait()
+        {
+          std::unique_lock<std::mutex> lock{ mutex };
+          condition.wait( lock, [this]{ return finished; } );
+        }
+
+        /// Pin the borrowed thread to a cpu, and later leases at this index.
+        ///
+        /// @return false if pinning is unsupported or the cpu is unavailable.
+        ///
+        bool pin( size_t cpu ) { return cpu != unpinned && instance().pin( index, slot, cpu ); }
+
+        /// Restore the borrowed thread's default affinity, and forget the
+        /// pin of this index.
+        ///
+        /// @return false if the affinity could not be restored.
+        ///
+        bool unpin() { return instance().pin( index, slot, unpinned ); }
+
+        ~Lease() { wait(); }
+
+       protected:
+        friend class Registry;
+
+        void finish()
+        {
+          std::lock_guard<std::mutex> lock{ mutex };
+          finished = true;
+          condition.notify_all();
+        }
+
+        // Completion state precedes slot: the job may finish during borrow.
+        //
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool finished = false;
+        const size_t index;
+        Slot & slot;
+      };
+
+      /// Query the number of threads the registry has spawned.
+      ///
+      static size_t size()
+      {
+        auto & registry = instance();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+        return registry.slots.size();
+      }
+
+     protected:
+      static constexpr size_t unpinned = ~size_t{ 0 };
+
+      // Joins the threads parked at exit.
+      //
+      struct Shutdown {
+        Registry & registry;
+        ~Shutdown() { registry.shutdown(); }
+      };
+
+      Registry() = default;
+
+      static Registry & instance()
+      {
+        static Registry & registry = *new Registry;
+        static Shutdown shutdown{ registry };
+        return registry;
+      }
+
+      // Stop and join parked threads. Leased threads keep running, and park
+      // for good if their job ever returns.
+      //
+      void shutdown()
+      {
+        std::lock_guard<std::mutex> lock{ mutex };
+        for( auto & slot : slots )
+        {
+          if( slot->parked )
+          {
+            {
+              std::lock_guard<std::mutex> guard{ slot->mutex };
+              slot->stop = true;
+            }
+            slot->condition.notify_one();
+            slot->thread.join();
+            slot->parked = false;
+          }
+        }
+      }
+
+      Slot & borrow( size_t index, std::function<void()> && job, Lease & lease )
+      {
+        std::lock_guard<std::mutex> lock{ mutex };
+        Slot * slot = nullptr;
+        if( index < slots.size() && slots[ index ]->parked )
+        {
+          slot = slots[ index ].get();
+        }
+        for( size_t other = 0; !slot && other < slots.size(); ++other )
+        {
+          if( slots[ other ]->parked )
+          {
+            slot = slots[ other ].get();
+          }
+        }
+
+        const bool spawn = !slot;
+        if( spawn )
+        {
+          slots.emplace_back( std::make_unique<Slot>() );
+          slot = slots.back().get();
+
+          // Threads inherit the spawning thread's affinity; remember it as
+          // the default to restore when unpinned.
+          //
+#ifdef __linux__
+          CPU_ZERO( &slot->affinity );
+          pthread_getaffinity_np( pthread_self(), sizeof( slot->affinity ), &slot->affinity );
+#endif
+        }
+        slot->parked = false;
+
+        {
+          std::lock_guard<std::mutex> guard{ slot->mutex };
+          slot->job = std::move( job );
+          slot->lease = &lease;
+        }
+        if( spawn )
+        {
+          slot->thread = std::thread( [this,slot]{ run( *slot ); } );
+        }
+
+        // Match the thread to this index's pin, whichever index it had.
+        //
+        const auto cpu = index < pins.size() ? pins[ index ] : unpinned;
+        if( slot->cpu != cpu )
+        {
+          apply( *slot, cpu );
+        }
+
+        if( !spawn )
+        {
+          slot->condition.notify_one();
+        }
+        return *slot;
+      }
+
+      // Pin the slot's thread and remember the pin for the index.
+      //
+      bool pin( size_t index, Slot & slot, size_t cpu )
+      {
+        std::lock_guard<std::mutex> lock{ mutex };
+        if( !apply( slot, cpu ) )
+        {
+          return false;
+        }
+        if( index >= pins.size() )
+        {
+          pins.resize( index + 1, size_t{ unpinned } );
+        }
+        pins[ index ] = cpu;
+        return true;
+      }
+
+      // Set the slot's thread affinity to cpu, or its default if unpinned.
+      //
+      static bool apply( Slot & slot, size_t cpu )
+      {
+#ifdef __linux__
+        cpu_set_t set = slot.affinity;
+        if( cpu != unpinned )
+        {
+          if( cpu >= CPU_SETSIZE )
+          {
+            return false;
+          }
+          CPU_ZERO( &set );
+          CPU_SET( cpu, &set );
+        }
+        if( 0 != pthread_setaffinity_np( slot.thread.native_handle(), sizeof( set ), &set ) )
+        {
+          return false;
+        }
+        slot.cpu = cpu;
+        return true;
+#else
+        return cpu == unpinned;
+#endif
+      }
+
+      // Thread body: run each job handed over, parking between them.
+      //
+      void run( Slot & slot )
+      {
+        std::unique_lock<std::mutex> lock{ slot.mutex };
+        for(;;)
+        {
+          slot.condition.wait( lock, [&slot]{ return slot.job || slot.stop; } );
+          if( !slot.job )
+          {
+            return;
+          }
+          auto job = std::move( slot.job );
+          auto lease = slot.lease;
+          slot.job = nullptr;
+          lock.unlock();
+
+          job();
+          job = nullptr;
+
+          // Park before reporting completion, so an executor created after
+          // this one is destroyed finds the thread free.
+          //
+          {
+            std::lock_guard<std::mutex> guard{ mutex };
+            slot.parked = true;
+          }
+          lease->finish();
+          lock.lock();
+        }
+      }
+
+      struct Slot {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::function<void()> job;
+        Lease * lease = nullptr;
+        bool stop = false;
+        bool parked = false;
+        size_t cpu = unpinned;  ///< Cpu the thread is pinned to.
+#ifdef __linux__
+        cpu_set_t affinity;     ///< Affinity at spawn.
+#endif
+      };
+
+      std::mutex mutex;
+      std::vector<std::unique_ptr<Slot>> slots;
+      std::vector<size_t> pins;  ///< Cpu pinned per worker index.
+    };
+
     /// Execution class that uses dedicated threads to provide parallelism.
     ///
     class ThreadModel {
      public:
       using Idle = detail::idle::Wait;
 
-      /// Create a thread per worker.
+      /// Borrow a thread per worker from the Registry.
       ///
       /// @tparam Iterator Type of iterator.
       /// @param begin first iterator to run.
@@ -242,33 +646,72 @@ namespace rabid {
       {
         for( auto func = begin; func != end; ++func )
         {
-          threads.emplace_back( std::make_unique<Thread>( *func ) );
+          threads.emplace_back( std::make_unique<Thread>( threads.size(), *func ) );
+        }
+
+        // Arrange idle objects as a binary heap for broadcast wakes.
+        //
+        const auto child = [this]( size_t index ) { return index < threads.size() ? &threads[ index ]->idle : nullptr; };
+        for( size_t index = 0; index < threads.size(); ++index )
+        {
+          threads[ index ]->idle.adopt( child( 2 * index + 1 ), child( 2 * index + 2 ) );
         }
       }
 
-      /// Stop all threads, joining them.
+      /// Wake all threads via tree propagation.
+      ///
+      void wake()
+      {
+        if( !threads.empty() )
+        {
+          threads.front()->idle.broadcast();
+        }
+      }
+
+      /// Pin a worker's thread to a cpu, taking effect immediately.
+      ///
+      /// The Registry keeps the pin for the worker index, so later executors
+      /// start with the same placement.
+      ///
+      /// @return false if pinning is unsupported or the cpu is unavailable.
+      ///
+      bool pin( size_t index, size_t cpu )
+      {
+        return index < threads.size() && threads[ index ]->lease.pin( cpu );
+      }
+
+      /// Restore a worker's default affinity, dropping its kept pin.
+      ///
+      /// @return false if the affinity could not be restored.
+      ///
+      bool unpin( size_t index )
+      {
+        return index < threads.size() && threads[ index ]->lease.unpin();
+      }
+
+      /// Stop all workers, waiting for their threads to return to the Registry.
       ///
       ~ThreadModel()
       {
         for( auto & thread : threads )
         {
           thread->idle.enable( false );
-          thread->thread.join();
+          thread->lease.wait();
         }
       }
 
      protected:
-      // Helper class that wraps a thread handle and idle object
+      // Helper class that wraps a thread lease and idle object
       //
       struct Thread {
         Idle idle;
-        std::thread thread;
+        Registry::Lease lease;
 
-        // Spawn thread, running function by reference.
+        // Borrow thread, running function by reference.
         //
         template < typename Function >
-        Thread( Function && function )
-        : thread( [&]{ function( idle ); } )
+        Thread( size_t index, Function && function )
+        : lease( index, [this,&function]{ function( idle ); } )
         {}
       };
 
@@ -290,6 +733,11 @@ namespace rabid {
   ///   - concurrency(): Query the number of threads in the range [0,n).
   ///   - current():  Query the index of the current thread.
   ///   - async(target, functor): Evaluate the functor in the specfied thread.
+  ///   - idle(): Query the number of idle workers.
+  ///   - split(first, last, grain, functor, done): Evaluate a range in
+  ///     adaptively split pieces.
+  ///   - background(functor): Run low priority slices while otherwise idle.
+  ///   - checkpoint(): Run queued messages from inside a long task.
   ///
   /// These static methods are only valid within threads managed by Executor.
   ///
@@ -318,12 +766,19 @@ namespace rabid {
    public:
     /// Create a new executor with the specified number of workers.
     ///
+    /// Queueing delay sampling stamps one in every sample_period messages
+    /// sent between workers with the send time. Recipients record the delay
+    /// until evaluation per inbound connection (see stats()).
+    ///
     /// @param size Number of workers to insantiate.
+    /// @param sample_period Messages per sample, or zero to disable sampling.
     /// 
-    Executor( size_t size = std::thread::hardware_concurrency() )
+    Executor( size_t size = std::thread::hardware_concurrency(), size_t sample_period = 0 )
     : /* active( size )
     , */ interconnect( size )
-    , workers( make_workers( interconnect, size, *this ) )
+    , idling( std::make_unique<std::atomic<bool>[]>( size ) )
+    , ledgers( std::make_unique<accounting::Ledger[]>( size ) )
+    , workers( make_workers( interconnect, size, sample_period, *this ) )
     , execution( workers.begin(), workers.end() )
     {}
 
@@ -331,6 +786,49 @@ namespace rabid {
     ///
     size_t size() const { return workers.size(); }
 
+    /// Wake all workers in preparation for a burst of work.
+    ///
+    /// Wakes propagate through the execution model (i.e. as a tree), so the
+    /// caller does not pay for waking each worker sequentially. Workers that
+    /// find no work simply go back to sleep.
+    ///
+    void wake() { execution.wake(); }
+
+    /// Pin a worker to a cpu, if the execution model supports it.
+    ///
+    /// May be called while the executor runs; the worker moves at once. The
+    /// pin carries over to the same worker of later executors until unpin().
+    ///
+    /// @param index Specifies worker to pin.
+    /// @param cpu Specifies the cpu to run it on.
+    /// @return false if the worker could not be pinned.
+    ///
+    bool pin( size_t index, size_t cpu ) { return execution.pin( index, cpu ); }
+
+    /// Undo pin() for a worker, in this and later executors.
+    ///
+    /// @param index Specifies worker to unpin.
+    /// @return false if the worker's affinity could not be restored.
+    ///
+    bool unpin( size_t index ) { return execution.unpin( index ); }
+
+    /// Access statistics for the specified worker.
+    ///
+    /// Statistics may be read from any thread while the executor runs.
+    ///
+    /// @param index Specifies worker to query.
+    ///
+    const stats::Worker & stats( size_t index ) const { return workers[ index ].statistics; }
+
+    /// Access allocation counts charged to the specified worker.
+    ///
+    /// Counts remain zero unless built with RABID_ACCOUNTING (see accounting.h).
+    ///
+    /// @param index Specifies worker to query.
+    ///
+    const accounting::Ledger & ledger( size_t index ) const { return ledgers[ index ]; }
+    accounting::Ledger & ledger( size_t index ) { return ledgers[ index ]; }
+
     /// Asynchronously evaluate a functor in the framework.
     ///
     /// Functors within the framework may use Executor's rich vocabulary of
@@ -351,6 +849,44 @@ namespace rabid {
       workers[ index ].send( task.leak() );
     }
 
+    /// Evaluate function( index ) on every worker, and wait for all of them.
+    ///
+    /// Only valid outside Executor, since the caller blocks.
+    ///
+    /// @param function Functor accepting the index of the worker it runs on.
+    ///
+    template < typename Function >
+    void each( Function && function )
+    {
+      detail::Counter counter{ 0 };
+      each( counter, std::forward<Function>( function ) );
+    }
+
+    /// Evaluate function( index ) on every worker, then wait for counter.
+    ///
+    /// The counter is reset to one event per worker, so work the function
+    /// starts can be awaited too by incrementing the counter when it is sent
+    /// and decrementing it when it completes.
+    ///
+    /// @param counter Counter to reset and wait on.
+    /// @param function Functor accepting the index of the worker it runs on.
+    ///
+    template < typename Function >
+    void each( detail::Counter & counter, Function && function )
+    {
+      counter.reset( size() );
+      wake();
+      for( size_t index = 0; index < size(); ++index )
+      {
+        inject( index, [&counter,&function]
+          {
+            function( current() );
+            counter.decrement();
+          });
+      }
+      counter.wait();
+    }
+
     /// Asynchronously evaluate a functor in the framework.
     ///
     /// Efficiently sends the functor to the specified worker from the current
@@ -369,14 +905,14 @@ namespace rabid {
     {
       auto task = make_task( index, std::forward<Function>( function ) );
       acquire( task );
-      current_worker->send( task );
+      current_worker->dispatch( task );
       return task;
     }
 
     /// Re-evaluate the current task elsewhere.
     ///
     /// Note: Only valid within Executor! May only be called once per task
-    /// invocation!
+    /// invocation! Does nothing in functors spawned in a Scope.
     ///
     /// After the current task ends, it is moved to the specified worker and
     /// re-evaluated. The result is discarded and pending tasks remain pending.
@@ -405,6 +941,92 @@ namespace rabid {
     ///
     static bool available() { return current_worker != nullptr; }
 
+    /// Query the number of workers that found no work in their last sweep.
+    ///
+    /// Note: Only valid within Executor!
+    ///
+    static size_t idle() { return current_worker->parent.idle_count.load( std::memory_order_relaxed ); }
+
+    /// Evaluate function( begin, end ) over [first,last) in adaptive pieces.
+    ///
+    /// Note: Only valid within Executor!
+    ///
+    /// Replaces a fixed job count with lazy splitting: the range is consumed
+    /// grain items at a time, and between grains the remainder is halved only
+    /// if another worker is idle. The upper half is sent to that worker, which
+    /// may split it further. While every worker is busy the range runs as a
+    /// single task, so the number of pieces tracks available parallelism
+    /// rather than a tuning knob.
+    ///
+    /// After every piece has finished, done() is evaluated on the worker that
+    /// finished last, with all pieces' writes visible.
+    ///
+    /// @param first Start of range.
+    /// @param last End of range.
+    /// @param grain Items evaluated between checks for idle workers.
+    /// @param function Functor accepting a subrange [begin,end).
+    /// @param done Functor evaluated when the range is complete.
+    ///
+    template < typename Function, typename Done >
+    static void split( size_t first, size_t last, size_t grain, Function && function, Done && done )
+    {
+      auto range = new Range<typename std::decay<Function>::type, typename std::decay<Done>::type>{
+        std::forward<Function>( function ), std::forward<Done>( done ), std::max( grain, size_t{1} ) };
+      range->run( first, last );
+    }
+
+    /// Let messages queued to the current worker run inside a long task.
+    ///
+    /// Note: Only valid within Executor!
+    ///
+    /// A task that runs for a long time (i.e. a large merge) blocks every
+    /// message sent to its worker. Calling checkpoint() periodically makes a
+    /// single pass over the worker's connections whenever a message is
+    /// waiting, and is otherwise a cheap check. Reentrancy rules:
+    ///
+    ///   - Tasks run by the pass share the worker, so worker-local state
+    ///     (shards, pools, arenas) may change across the call. The caller
+    ///     must not hold iterators or references into such state, and must
+    ///     leave it consistent, before calling.
+    ///   - The calling task stays owned by the outer pass and is not
+    ///     re-entered. Nested tasks restore the current expression when they
+    ///     finish, so a defer() made before the call still applies.
+    ///   - Checkpoints do not nest: one called from a task that a checkpoint
+    ///     is running does nothing, bounding the stack to one extra pass.
+    ///     Tasks run by a Scope's join() may checkpoint, unless joins are
+    ///     nested more than a few deep on the worker.
+    ///
+    /// @return number of tasks evaluated.
+    ///
+    static size_t checkpoint() { return current_worker->checkpoint(); }
+
+    /// Queue low priority work on the current worker.
+    ///
+    /// Note: Only valid within Executor! Use inject() to queue work on a
+    /// specific worker from outside.
+    ///
+    /// Background work runs only once the worker has found no messages in
+    /// consecutive sweeps, as a series of slices: each call of function() should
+    /// do a bounded amount of work, and return true to be called again or
+    /// false once finished. Between slices the worker checks its inbound
+    /// connections and returns to messages as soon as any arrive. After a
+    /// bounded number of slices without messages the worker parks for a short
+    /// pause (or until woken) before slicing again, so unfinished work never
+    /// keeps a worker spinning, and stops once the executor is destroyed.
+    ///
+    /// Queued functions are called round-robin, so one long-lived task (e.g.
+    /// periodic compaction) does not starve the others.
+    ///
+    /// @param function Functor returning bool, called once per slice.
+    ///
+    template < typename Function >
+    static void background( Function && function )
+    {
+      current_worker->slices.emplace_back( std::forward<Function>( function ) );
+    }
+
+    class Scope;
+
     /*void wait() { active.wait(); }*/
 
    protected:
@@ -430,7 +1052,24 @@ namespace rabid {
     enum class Tag {
       normal,   ///< Task evaluated by recipient.
       reverse,  ///< Task removed and evaluated by sender.
-      delay     ///< TODO: See enum discussion.
+      delay,    ///< TODO: See enum discussion.
+      scoped    ///< ScopedTask evaluated by recipient, owned by a Scope.
+    };
+
+    /// Task spawned within a Scope.
+    ///
+    /// Scoped tasks are neither reference counted nor individually freed: the
+    /// owning Scope destroys them after all have finished. Evaluating a scoped
+    /// task signals the scope last, after which the task must not be touched.
+    ///
+    struct ScopedTask : public interconnect::Message {
+      using interconnect::Message::Message;
+
+      virtual void evaluate() = 0;
+      virtual ~ScopedTask() = default;
+
+      ScopedTask * sibling = nullptr;   ///< Next task in the owning scope.
+      bool owned = false;               ///< Storage is heap allocated.
     };
 
     /// Adapter that dispatches promises within an Executor.
@@ -452,7 +1091,7 @@ namespace rabid {
       template < typename T >
       friend void dispatch( T && task )
       {
-        current_worker->send( task );
+        current_worker->dispatch( task );
         task.leak();
       }
     };
@@ -492,7 +1131,7 @@ namespace rabid {
       typename Result = typename function_traits<Function>::return_type >
     static referenced::Pointer<Task> make_task( DispatchSpec && dispatch, Function && function )
     {
-      return new Continuation<Function, Arg, Result>{ std::forward<DispatchSpec>( dispatch ), std::forward<Function>( function ) };
+      return new ( accounting::Kind::task ) Continuation<Function, Arg, Result>{ std::forward<DispatchSpec>( dispatch ), std::forward<Function>( function ) };
     }
 
     /// Executor worker, executes and sends tasks within the ExecutionModel.
@@ -501,10 +1140,13 @@ namespace rabid {
     ///
     class Worker {
      public:
-      Worker( const typename Interconnect::NodeType & node_arg, Executor & parent_arg, const size_t index_arg )
+      Worker( const typename Interconnect::NodeType & node_arg, Executor & parent_arg, const size_t index_arg, const size_t sample_period, const size_t count )
       : node( node_arg )
       , parent( parent_arg )
       , index( index_arg )
+      , statistics( node_arg.all().size(), sample_period != 0, count )
+      , period( sample_period )
+      , countdown( sample_period )
       {}
 
       // Unclear why we need to force the move constructor generation.
@@ -521,7 +1163,10 @@ namespace rabid {
       {
         node.clear( []( const TaggedPointer<interconnect::Message> & message )
           {
-            release( message.template cast<Task>() );
+            if( message.template tag<Tag>() != Tag::scoped )
+            {
+              release( message.template cast<Task>() );
+            }
           });
       }
 
@@ -534,9 +1179,74 @@ namespace rabid {
       ///
       void send( Task * task )
       {
+        RABID_PROBE2( send, index, task->address );
         node.send( TaggedPointer<Task>{ task, Tag::normal }.template cast<interconnect::Message>(), PrepareMessage{} );
       }
 
+      /// Send a task from this worker, usurping the current reference.
+      ///
+      /// Only valid from the worker's own thread. Counts the task in the
+      /// worker's traffic row, and stamps every period-th task with the send
+      /// time for queueing delay sampling. A zero period disables sampling.
+      ///
+      void dispatch( Task * task )
+      {
+        statistics.message( task->address );
+        if( period && --countdown == 0 )
+        {
+          countdown = period;
+          task->stamp = stats::stamp();
+        }
+        send( task );
+      }
+
+      /// Send a scoped task. The owning scope retains the task's storage.
+      ///
+      /// Only valid from the worker's own thread, which scopes run on.
+      ///
+      void send( ScopedTask * task )
+      {
+        statistics.message( task->address );
+        RABID_PROBE2( send, index, task->address );
+        node.send( TaggedPointer<ScopedTask>{ task, Tag::scoped }.template cast<interconnect::Message>(), PrepareMessage{} );
+      }
+
+      /// Process pending messages once, without yielding.
+      ///
+      /// Only valid from the worker's own thread. Used to make progress while
+      /// a task waits on nested work.
+      ///
+      /// @return number of tasks evaluated.
+      ///
+      size_t poll()
+      {
+        detail::idle::Spin spin;
+        MessageAgent<detail::idle::Spin> agent{ spin, statistics };
+        node.operate( agent );
+        return agent.processed;
+      }
+
+      /// Process pending messages once from inside a running task.
+      ///
+      /// Only valid from the worker's own thread. Does nothing unless a
+      /// message has arrived, or when called from a task that a checkpoint
+      /// is already running, so passes never nest. Also does nothing under
+      /// more than join_limit nested joins, bounding the stack they add to.
+      ///
+      /// @return number of tasks evaluated.
+      ///
+      size_t checkpoint()
+      {
+        if( depth != 0 || joins > join_limit || !node.pending( arrived ) )
+        {
+          return 0;
+        }
+        depth += 1;
+        const auto processed = poll();
+        depth -= 1;
+        return processed;
+      }
+
       /// Event loop for the worker, specialized based on idle type.
       ///
       /// Runs until (1) no tasks remain and (2) idle.yield() indicates exit.
@@ -556,32 +1266,121 @@ namespace rabid {
       void operator()( Idle && idle )
       {
         current_worker = this;
-        MessageAgent<Idle> agent{ idle };
+        accounting::attach( &parent.ledgers[ index ] );
+        MessageAgent<Idle> agent{ idle, statistics };
+        bool marked = false;
+        size_t sliced = 0;
         for(;;)
         {
+          RABID_PROBE1( sweep_begin, index );
           node.operate( agent );
+          RABID_PROBE2( sweep_end, index, agent.processed );
           if( agent.processed == 0 )
           {
             if( agent.prepare_idle )
             {
-              const bool exit = !idle.yield();
+              if( idle.running() && sliced < background_slices )
+              {
+                const auto ran = run_background( background_slices - sliced );
+                if( ran )
+                {
+                  sliced += ran;
+                  agent.prepare_idle = false;
+                  continue;
+                }
+              }
+              RABID_PROBE1( yield, index );
+              const bool exit = !( sliced ? idle.yield( background_pause() ) : idle.yield() );
+              RABID_PROBE1( wake, index );
               if( exit )
               {
                 break;
               }
+              sliced = 0;
+            }
+            else if( !marked )
+            {
+              mark_idle( true );
+              marked = true;
             }
             agent.prepare_idle = !agent.prepare_idle;
           }
           else
           {
+            if( marked )
+            {
+              mark_idle( false );
+              marked = false;
+            }
             agent.prepare_idle = false;
+            sliced = 0;
           }
           agent.processed = 0;
         }
+        if( marked )
+        {
+          mark_idle( false );
+        }
+        accounting::attach( nullptr );
         current_worker = nullptr;
       }
      protected:
 
+      /// Run background slices until a message arrives or budget is spent.
+      ///
+      /// Each queued function gets at most one slice per call, after which the
+      /// worker sweeps its connections again. Sentinels left by the idle sweep
+      /// do not count as arrivals.
+      ///
+      /// @param budget Most slices to run.
+      /// @return number of slices run.
+      ///
+      size_t run_background( size_t budget )
+      {
+        size_t ran = 0;
+        for( budget = std::min( budget, slices.size() ); budget && !slices.empty() && !node.pending( arrived ); --budget )
+        {
+          slice = slice % slices.size();
+          if( slices[ slice ]() )
+          {
+            slice += 1;
+          }
+          else
+          {
+            slices.erase( slices.begin() + ssize_t( slice ) );
+          }
+          ran += 1;
+        }
+        return ran;
+      }
+
+      /// Filter for Node::pending(): true for real messages, false for
+      /// sentinels left by the idle sweep.
+      ///
+      static bool arrived( const interconnect::Message::PointerType & message )
+      {
+        return message.template tag<Tag>() != Tag::reverse;
+      }
+
+      /// Publish idle state for Executor::split().
+      ///
+      /// Only transitions are published, so busy workers never touch the
+      /// shared flags. A splitter may claim (clear) the flag first, in which
+      /// case it has already adjusted the count.
+      ///
+      void mark_idle( bool value )
+      {
+        if( value )
+        {
+          parent.idle_count.fetch_add( 1, std::memory_order_relaxed );
+          parent.idling[ index ].store( true, std::memory_order_relaxed );
+        }
+        else if( parent.idling[ index ].exchange( false, std::memory_order_relaxed ) )
+        {
+          parent.idle_count.fetch_sub( 1, std::memory_order_relaxed );
+        }
+      }
+
       /// Helper class that detects and invokes reverse messages during send.
       ///
       /// Messages are sent via CAS loop. Captures the prior value and ensures
@@ -623,12 +1422,14 @@ namespace rabid {
       struct MessageAgent
       {
         Idle & idle;
+        stats::Worker & statistics;
         interconnect::Batch cache;
         size_t processed = 0;
         bool prepare_idle = false;
 
-        MessageAgent( Idle & idle_arg )
+        MessageAgent( Idle & idle_arg, stats::Worker & statistics_arg )
         : idle( idle_arg )
+        , statistics( statistics_arg )
         {}
 
         ~MessageAgent()
@@ -639,15 +1440,30 @@ namespace rabid {
           }
         }
 
-        void receive( const TaggedPointer<interconnect::Message> & message )
+        void receive( const TaggedPointer<interconnect::Message> & message, size_t connection )
         {
           if( message.template tag<Tag>() == Tag::normal )
           {
             const auto task = message.template cast<Task>();
+            if( task->stamp )
+            {
+              statistics.delay( connection ).insert( stats::elapsed( task->stamp ) );
+              task->stamp = 0;
+            }
+            RABID_PROBE2( task_begin, current_worker->index, task.get() );
             task->evaluate();
+            RABID_PROBE2( task_end, current_worker->index, task.get() );
             processed += 1;
             release( task );
           }
+          else if( message.template tag<Tag>() == Tag::scoped )
+          {
+            const auto task = message.template cast<ScopedTask>();
+            RABID_PROBE2( task_begin, current_worker->index, task.get() );
+            task->evaluate();
+            RABID_PROBE2( task_end, current_worker->index, task.get() );
+            processed += 1;
+          }
           else
           {
             cache.insert( message );
@@ -692,23 +1508,114 @@ namespace rabid {
      public:
       Executor & parent;
       const size_t index;
+      stats::Worker statistics;
+      detail::Arena arena{ 64 * 1024 };  ///< Storage for scoped tasks.
+      size_t joins = 0;  ///< Scope joins in progress, see checkpoint().
+      std::vector<std::function<bool()>> slices;  ///< Background work, see background().
+     protected:
+      const size_t period;
+      size_t countdown;
+      size_t slice = 0;  ///< Next background function to run.
+
+      /// Most background slices run per idle period before the worker parks.
+      ///
+      static constexpr size_t background_slices = 64;
+
+      /// Longest the worker parks between bursts of background slices.
+      ///
+      static std::chrono::milliseconds background_pause() { return std::chrono::milliseconds{ 1 }; }
+      size_t depth = 0;  ///< Checkpoints in progress, see checkpoint().
+
+      /// Most nested joins under which checkpoint() still runs passes.
+      ///
+      static constexpr size_t join_limit = 8;
     };
 
+    /// Shared state for split(), freed after the last piece finishes.
+    ///
+    template < typename Function, typename Done >
+    struct Range {
+      Function function;
+      Done done;
+      const size_t grain;
+      std::atomic<size_t> pending{ 1 };
+
+      static void * operator new( size_t bytes ) { return accounting::allocate( bytes, accounting::Kind::range ); }
+      static void operator delete( void * pointer ) { accounting::deallocate( pointer ); }
+
+      void run( size_t first, size_t last )
+      {
+        while( first < last )
+        {
+          const auto end = std::min( last, first + grain );
+          function( first, end );
+          first = end;
+
+          if( last - first > grain )
+          {
+            const auto target = current_worker->parent.claim_idle();
+            if( target != current_worker->parent.size() )
+            {
+              const auto middle = first + ( last - first ) / 2;
+              pending.fetch_add( 1, std::memory_order_relaxed );
+              async( target, [this,middle,last]{ run( middle, last ); } );
+              last = middle;
+            }
+          }
+        }
+
+        if( pending.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        {
+          done();
+          delete this;
+        }
+      }
+    };
+
+    /// Claim an idle worker, clearing its idle flag.
+    ///
+    /// Claiming prevents concurrent splits from piling onto the same worker.
+    /// Scanning starts after the current worker to spread claims.
+    ///
+    /// @return index of the claimed worker, or size() if none are idle.
+    ///
+    size_t claim_idle()
+    {
+      if( idle_count.load( std::memory_order_relaxed ) == 0 )
+      {
+        return size();
+      }
+
+      for( size_t offset = 1; offset < size(); ++offset )
+      {
+        const auto index = ( current_worker->index + offset ) % size();
+        if( idling[ index ].load( std::memory_order_relaxed ) && idling[ index ].exchange( false, std::memory_order_relaxed ) )
+        {
+          idle_count.fetch_sub( 1, std::memory_order_relaxed );
+          return index;
+        }
+      }
+      return size();
+    }
+
     /// Helper to initialize a vector of workers--cleans up constructor.
     ///
-    static std::vector<Worker> make_workers( Interconnect & interconnect, size_t count, Executor & parent )
+    static std::vector<Worker> make_workers( Interconnect & interconnect, size_t count, size_t sample_period, Executor & parent )
     {
       std::vector<Worker> workers;
       workers.reserve( count );
       for( size_t index = 0; index < count; ++index )
       {
-        workers.emplace_back( interconnect.node( index ), parent, index );
+        workers.emplace_back( interconnect.node( index ), parent, index, sample_period, count );
       }
       return workers;
     }
 
     //detail::Counter active;
     Interconnect interconnect;
+    std::unique_ptr<std::atomic<bool>[]> idling;  ///< Per worker idle flags.
+    std::atomic<size_t> idle_count{ 0 };          ///< Number of idling flags set.
+    std::unique_ptr<accounting::Ledger[]> ledgers;  ///< Per worker allocation counts.
     std::vector<Worker> workers;
     ExecutionModel execution;
     static thread_local Worker * current_worker;
@@ -716,4 +1623,124 @@ namespace rabid {
 
   template < typename Interconnect, typename ExecutionModel >
   thread_local typename Executor<Interconnect,ExecutionModel>::Worker * Executor<Interconnect,ExecutionModel>::current_worker = nullptr;
+
+  /// Fork/join region whose tasks live on the spawning worker's arena.
+  ///
+  /// When a task forks sub-tasks and waits for them before returning, the
+  /// sub-tasks' lifetimes are strictly nested within the task. Scope exploits
+  /// that: spawned tasks are placed on the current worker's stack-like arena
+  /// (falling back to the heap when exhausted), are not reference counted,
+  /// and are destroyed in bulk when the scope ends.
+  ///
+  /// join() guarantees every spawned task has finished before storage is
+  /// reused. While joining, the worker keeps processing inbound messages,
+  /// so tasks may be spawned on any worker--including the current one.
+  ///
+  /// Note: Only valid within Executor! Scopes must begin and end within a
+  /// single task invocation. Spawned functors are not tasks, so they have no
+  /// result to chain, and defer() does nothing inside them.
+  ///
+  template < typename Interconnect, typename ExecutionModel >
+  class Executor<Interconnect,ExecutionModel>::Scope {
+   public:
+    Scope()
+    : worker( *current_worker )
+    , mark( worker.arena.mark() )
+    {}
+
+    Scope( const Scope & ) = delete;
+    Scope & operator = ( const Scope & ) = delete;
+
+    /// Join, then destroy all spawned tasks and release their storage.
+    ///
+    ~Scope()
+    {
+      join();
+      while( tasks )
+      {
+        const auto task = tasks;
+        const auto owned = task->owned;
+        tasks = task->sibling;
+        task->~ScopedTask();
+        if( owned )
+        {
+          accounting::deallocate( task );
+        }
+      }
+      worker.arena.rewind( mark );
+    }
+
+    /// Evaluate a functor in the specified worker as part of this scope.
+    ///
+    /// @tparam Function Type of functor to execute.
+    /// @param index Specifies worker to run functor.
+    /// @param function Functor to capture and run.
+    ///
+    template < typename Function >
+    void spawn( size_t index, Function && function )
+    {
+      using Type = Spawned<std::decay_t<Function>>;
+      static_assert( alignof( Type ) <= alignof( std::max_align_t ), "heap fallback cannot over-align scoped tasks" );
+      void * storage = worker.arena.allocate( sizeof( Type ), alignof( Type ) );
+      const bool owned = storage == nullptr;
+      if( owned )
+      {
+        storage = accounting::allocate( sizeof( Type ), accounting::Kind::scoped );
+      }
+
+      auto task = new (storage) Type{ index, *this, std::forward<Function>( function ) };
+      task->owned = owned;
+      task->sibling = tasks;
+      tasks = task;
+
+      pending.fetch_add( 1, std::memory_order_relaxed );
+      worker.send( task );
+    }
+
+    /// Process messages until all spawned tasks have finished.
+    ///
+    void join()
+    {
+      worker.joins += 1;
+      while( pending.load( std::memory_order_acquire ) )
+      {
+        if( worker.poll() == 0 )
+        {
+          std::this_thread::yield();
+        }
+      }
+      worker.joins -= 1;
+    }
+
+   protected:
+    template < typename Function >
+    struct Spawned final : public ScopedTask {
+      template < typename ...Args >
+      Spawned( size_t index, Scope & scope_arg, Args && ...args )
+      : ScopedTask( index )
+      , scope( scope_arg )
+      , function( std::forward<Args>( args )... )
+      {}
+
+      // Scoped tasks are not expressions: hide the expression of any task
+      // whose join() is polling, so defer() cannot retarget it.
+      //
+      virtual void evaluate() override
+      {
+        using Expression = detail::expression::Expression<TaskDispatch>;
+        const auto prior = Expression::swap( nullptr );
+        function();
+        Expression::swap( prior );
+        scope.pending.fetch_sub( 1, std::memory_order_release );
+      }
+
+      Scope & scope;
+      Function function;
+    };
+
+    Worker & worker;
+    const detail::Arena::Mark mark;
+    ScopedTask * tasks = nullptr;
+    std::atomic<size_t> pending{ 0 };
+  };
 }
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace rabid {
+
+  /// Allocation accounting for rabid's own allocation sites.
+  ///
+  /// Tasks, continuations, promises, split ranges and scoped tasks beyond the
+  /// arena are allocated through allocate()/deallocate(). Long-lived storage
+  /// (interconnect buffers, scope arenas, worker statistics) is recorded with
+  /// a Charge. With RABID_ACCOUNTING defined, each allocation carries a small
+  /// header recording its kind and size, and is counted in:
+  ///
+  ///   - The ledger of the allocating (or freeing) thread. Executor workers
+  ///     attach their own ledger, other threads share an external ledger.
+  ///   - Process-wide totals.
+  ///
+  /// Every ledger tracks live and peak live bytes, and a Scope measures
+  /// deltas and the peak against any one ledger.
+  ///
+  /// Without RABID_ACCOUNTING the hooks forward directly to the global
+  /// allocator and all counts remain zero.
+  ///
+  /// Note: RABID_ACCOUNTING changes allocation layout, so every translation
+  /// unit in a program must agree on it.
+  ///
+  namespace accounting {
+
+    /// Allocation sites.
+    ///
+    enum class Kind : std::uint8_t {
+      task,           ///< Executor::async/inject/make_task.
+      continuation,   ///< Future::then and Promise::then.
+      promise,        ///< Promise().
+      buffer,         ///< Interconnect buffers.
+      range,          ///< Executor::split.
+      scoped,         ///< Scope::spawn tasks that did not fit the arena.
+      arena,          ///< Worker arenas backing Scope.
+      stats           ///< Worker statistics.
+    };
+
+    static constexpr size_t kinds = 8;
+
+    /// Query if accounting is compiled in.
+    ///
+    constexpr bool enabled()
+    {
+#ifdef RABID_ACCOUNTING
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    /// Snapshot of counts for one kind (or the sum of all kinds).
+    ///
+    struct Counts {
+      size_t allocations = 0;
+      size_t deallocations = 0;
+      size_t allocated = 0;   ///< Bytes allocated.
+      size_t freed = 0;       ///< Bytes freed.
+
+      Counts & operator += ( const Counts & other )
+      {
+        allocations += other.allocations;
+        deallocations += other.deallocations;
+        allocated += other.allocated;
+        freed += other.freed;
+        return *this;
+      }
+
+      Counts & operator -= ( const Counts & other )
+      {
+        allocations -= other.allocations;
+        deallocations -= other.deallocations;
+        allocated -= other.allocated;
+        freed -= other.freed;
+        return *this;
+      }
+    };
+
+    /// Per kind allocation counters, with live and peak live bytes.
+    ///
+    /// Memory may be freed by a different thread than allocated it, so a
+    /// single ledger's freed bytes may exceed its allocated bytes, and its
+    /// live bytes may be negative.
+    ///
+    class Ledger {
+     public:
+      /// Query bytes charged to this ledger and not yet refunded to it.
+      ///
+      std::ptrdiff_t live() const { return live_bytes.load( std::memory_order_relaxed ); }
+
+      /// Query the most live bytes seen since creation, or since the
+      /// innermost Scope on this ledger began.
+      ///
+      std::ptrdiff_t peak() const { return peak_bytes.load( std::memory_order_relaxed ); }
+
+      /// Query counts for a kind.
+      ///
+      Counts counts( Kind kind ) const
+      {
+        const auto & entry = entries[ size_t( kind ) ];
+        Counts result;
+        result.allocations = entry.allocations.load( std::memory_order_relaxed );
+        result.deallocations = entry.deallocations.load( std::memory_order_relaxed );
+        result.allocated = entry.allocated.load( std::memory_order_relaxed );
+        result.freed = entry.freed.load( std::memory_order_relaxed );
+        return result;
+      }
+
+      /// Query counts summed over all kinds.
+      ///
+      Counts counts() const
+      {
+        Counts result;
+        for( size_t kind = 0; kind < kinds; ++kind )
+        {
+          result += counts( Kind( kind ) );
+        }
+        return result;
+      }
+
+      void allocate( Kind kind, size_t bytes )
+      {
+        auto & entry = entries[ size_t( kind ) ];
+        entry.allocations.fetch_add( 1, std::memory_order_relaxed );
+        entry.allocated.fetch_add( bytes, std::memory_order_relaxed );
+        const auto current = live_bytes.fetch_add( std::ptrdiff_t( bytes ), std::memory_order_relaxed ) + std::ptrdiff_t( bytes );
+        raise( current );
+      }
+
+      void deallocate( Kind kind, size_t bytes )
+      {
+        auto & entry = entries[ size_t( kind ) ];
+        entry.deallocations.fetch_add( 1, std::memory_order_relaxed );
+        entry.freed.fetch_add( bytes, std::memory_order_relaxed );
+        live_bytes.fetch_sub( std::ptrdiff_t( bytes ), std::memory_order_relaxed );
+      }
+
+     protected:
+      friend class Scope;
+
+      void raise( std::ptrdiff_t bytes )
+      {
+        auto prior = peak_bytes.load( std::memory_order_relaxed );
+        while( prior < bytes && !peak_bytes.compare_exchange_weak( prior, bytes, std::memory_order_relaxed ) ) {}
+      }
+
+      /// Restart peak tracking from the current live bytes.
+      ///
+      /// @return the prior peak, to be restored with raise().
+      ///
+      std::ptrdiff_t restart() { return peak_bytes.exchange( live(), std::memory_order_relaxed ); }
+
+      struct Entry {
+        std::atomic<size_t> allocations{ 0 };
+        std::atomic<size_t> deallocations{ 0 };
+        std::atomic<size_t> allocated{ 0 };
+        std::atomic<size_t> freed{ 0 };
+      };
+
+      Entry entries[ kinds ];
+      std::atomic<std::ptrdiff_t> live_bytes{ 0 };
+      std::atomic<std::ptrdiff_t> peak_bytes{ 0 };
+    };
+
+    /// Process-wide totals of every ledger.
+    ///
+    inline Ledger & totals()
+    {
+      static Ledger instance;
+      return instance;
+    }
+
+    /// Ledger shared by threads without their own.
+    ///
+    inline Ledger & external()
+    {
+      static Ledger instance;
+      return instance;
+    }
+
+    /// Ledger charged by the current thread.
+    ///
+    inline Ledger *& attached()
+    {
+      static thread_local Ledger * ledger = nullptr;
+      return ledger;
+    }
+
+    /// Charge the current thread's allocations to the given ledger.
+    ///
+    /// @param ledger Ledger to charge, or nullptr for the external ledger.
+    ///
+    inline void attach( Ledger * ledger ) { attached() = ledger; }
+
+    inline Ledger & local()
+    {
+      const auto ledger = attached();
+      return ledger ? *ledger : external();
+    }
+
+    /// Record an allocation made outside of allocate().
+    ///
+    inline void charge( Kind kind, size_t bytes )
+    {
+      if( enabled() )
+      {
+        local().allocate( kind, bytes );
+        totals().allocate( kind, bytes );
+      }
+    }
+
+    /// Record a deallocation made outside of deallocate().
+    ///
+    inline void refund( Kind kind, size_t bytes )
+    {
+      if( enabled() )
+      {
+        local().deallocate( kind, bytes );
+        totals().deallocate( kind, bytes );
+      }
+    }
+
+#ifdef RABID_ACCOUNTING
+    /// Header preceding accounted allocations. Sized to preserve the
+    /// allocator's fundamental alignment.
+    ///
+    struct alignas(16) Header {
+      size_t bytes;
+      Kind kind;
+    };
+
+    inline void * allocate( size_t bytes, Kind kind )
+    {
+      const auto header = static_cast<Header*>( ::operator new( sizeof( Header ) + bytes ) );
+      header->bytes = bytes;
+      header->kind = kind;
+      charge( kind, bytes );
+      return header + 1;
+    }
+
+    inline void deallocate( void * pointer )
+    {
+      if( pointer )
+      {
+        const auto header = static_cast<Header*>( pointer ) - 1;
+        refund( header->kind, header->bytes );
+        ::operator delete( header );
+      }
+    }
+#else
+    inline void * allocate( size_t bytes, Kind ) { return ::operator new( bytes ); }
+    inline void deallocate( void * pointer ) { ::operator delete( pointer ); }
+#endif
+
+    /// Charges a fixed allocation for the lifetime of the object.
+    ///
+    /// For storage allocated by other means, such as interconnect buffers.
+    ///
+    class Charge {
+     public:
+      Charge( Kind kind_arg, size_t bytes_arg )
+      : kind( kind_arg )
+      , bytes( bytes_arg )
+      {
+        charge( kind, bytes );
+      }
+
+      Charge( const Charge & ) = delete;
+      Charge( Charge && other )
+      : kind( other.kind )
+      , bytes( other.bytes )
+      {
+        other.bytes = 0;
+      }
+
+      ~Charge()
+      {
+        if( bytes )
+        {
+          refund( kind, bytes );
+        }
+      }
+
+     protected:
+      Kind kind;
+      size_t bytes;
+    };
+
+    /// Measures a ledger's allocation counts from construction onwards.
+    ///
+    /// Measure a worker's ledger (see Executor::ledger()) to budget work on
+    /// that worker alone. The default, process-wide totals, include every
+    /// thread's allocations, so budgets are only meaningful while the measured
+    /// work is the only activity.
+    ///
+    /// A scope restarts its ledger's peak tracking, restoring the prior peak
+    /// when it ends, so scopes on one ledger must nest.
+    ///
+    class Scope {
+     public:
+      Scope( Ledger & ledger_arg = totals() )
+      : ledger( ledger_arg )
+      , base( ledger.live() )
+      , outer( ledger.restart() )
+      {
+        for( size_t kind = 0; kind < kinds; ++kind )
+        {
+          start[ kind ] = ledger.counts( Kind( kind ) );
+        }
+      }
+
+      Scope( const Scope & ) = delete;
+      Scope & operator = ( const Scope & ) = delete;
+
+      ~Scope() { ledger.raise( outer ); }
+
+      /// Counts for a kind since the scope began.
+      ///
+      Counts delta( Kind kind ) const
+      {
+        auto result = ledger.counts( kind );
+        result -= start[ size_t( kind ) ];
+        return result;
+      }
+
+      /// Peak live bytes above those live when the scope began.
+      ///
+      size_t peak() const
+      {
+        const auto bytes = ledger.peak() - base;
+        return bytes > 0 ? size_t( bytes ) : 0;
+      }
+
+      /// Counts for all kinds since the scope began.
+      ///
+      Counts delta() const
+      {
+        Counts result;
+        for( size_t kind = 0; kind < kinds; ++kind )
+        {
+          result += delta( Kind( kind ) );
+        }
+        return result;
+      }
+
+     protected:
+      Ledger & ledger;
+      const std::ptrdiff_t base;
+      const std::ptrdiff_t outer;
+      Counts start[ kinds ];
+    };
+  }
+}
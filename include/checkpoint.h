@@ -0,0 +1,315 @@
+#pragma once
+
+#include "Executor.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace rabid {
+
+  /// Parallel save and restore of worker-owned state.
+  ///
+  /// A checkpoint file holds one segment per worker behind an index header:
+  ///
+  ///   [ Header | Extent x workers ] [ segment 0 ] [ segment 1 ] ...
+  ///
+  /// Segments start on page boundaries so each can be mapped on its own.
+  /// Workers serialize and pwrite() their segments concurrently, then the
+  /// header is written and the file renamed into place, so an interrupted
+  /// save never replaces a good checkpoint. Restore maps each segment on the
+  /// worker that owns it, which then faults in only the pages it reads.
+  ///
+  namespace checkpoint {
+
+    struct Header {
+      char magic[ 8 ];
+      std::uint64_t segments;
+    };
+
+    struct Extent {
+      std::uint64_t offset;
+      std::uint64_t length;
+    };
+
+    static constexpr char magic[ 8 ] = { 'r', 'a', 'b', 'i', 'd', 'c', 'k', '1' };
+
+    /// Appends a worker's state to its segment.
+    ///
+    class Writer {
+     public:
+      void write( const void * data, size_t length )
+      {
+        const auto begin = static_cast<const char *>( data );
+        bytes.insert( bytes.end(), begin, begin + length );
+      }
+
+      template < typename T >
+      void write( const T & value )
+      {
+        static_assert( std::is_trivially_copyable<T>::value, "Only trivially copyable values may be written directly" );
+        write( &value, sizeof( value ) );
+      }
+
+      /// Write a length-prefixed array.
+      ///
+      template < typename T >
+      void write( const std::vector<T> & values )
+      {
+        static_assert( std::is_trivially_copyable<T>::value, "Only trivially copyable values may be written directly" );
+        const std::uint64_t count = values.size();
+        write( count );
+        write( values.data(), values.size() * sizeof( T ) );
+      }
+
+      void write( const std::string & value )
+      {
+        const std::uint64_t count = value.size();
+        write( count );
+        write( value.data(), value.size() );
+      }
+
+      size_t size() const { return bytes.size(); }
+      const char * data() const { return bytes.data(); }
+
+     protected:
+      std::vector<char> bytes;
+    };
+
+    /// Reads a worker's state back from its mapped segment.
+    ///
+    /// Reads past the end of the segment fail and leave the reader failed;
+    /// check good() once loading is done.
+    ///
+    class Reader {
+     public:
+      Reader( MappedFile file_arg, size_t skip, size_t length )
+      : file( std::move( file_arg ) )
+      , cursor( file.array<char>() + std::min( skip, file.size<char>() ) )
+      , end( cursor + std::min( length, file.size<char>() - std::min( skip, file.size<char>() ) ) )
+      , valid( skip + length <= file.size<char>() )
+      {}
+
+      bool read( void * data, size_t length )
+      {
+        const auto source = view( length );
+        if( source )
+        {
+          std::memcpy( data, source, length );
+        }
+        return source;
+      }
+
+      template < typename T >
+      bool read( T & value )
+      {
+        static_assert( std::is_trivially_copyable<T>::value, "Only trivially copyable values may be read directly" );
+        return read( &value, sizeof( value ) );
+      }
+
+      template < typename T >
+      bool read( std::vector<T> & values )
+      {
+        std::uint64_t count = 0;
+        if( !read( count ) || count > remaining() / sizeof( T ) )
+        {
+          valid = false;
+          return false;
+        }
+        values.resize( count );
+        return read( values.data(), values.size() * sizeof( T ) );
+      }
+
+      bool read( std::string & value )
+      {
+        std::uint64_t count = 0;
+        if( !read( count ) || count > remaining() )
+        {
+          valid = false;
+          return false;
+        }
+        value.assign( view( count ), count );
+        return true;
+      }
+
+      /// Consume length bytes in place, without copying.
+      ///
+      /// The bytes remain valid as long as the mapping, see release().
+      ///
+      /// @return pointer to the bytes, or nullptr past the end of the segment.
+      ///
+      const char * view( size_t length )
+      {
+        if( !valid || length > remaining() )
+        {
+          valid = false;
+          return nullptr;
+        }
+        const auto result = cursor;
+        cursor += length;
+        return result;
+      }
+
+      size_t remaining() const { return size_t( end - cursor ); }
+      bool good() const { return valid; }
+
+      /// Take ownership of the mapping to keep viewed bytes alive.
+      ///
+      MappedFile release() { return std::move( file ); }
+
+     protected:
+      MappedFile file;
+      const char * cursor;
+      const char * end;
+      bool valid;
+    };
+
+    namespace detail {
+
+      inline size_t page() { return size_t( ::sysconf( _SC_PAGESIZE ) ); }
+
+      inline size_t align( size_t offset ) { return ( offset + page() - 1 ) / page() * page(); }
+
+      inline bool pwrite( int fd, const char * data, size_t length, size_t offset )
+      {
+        while( length )
+        {
+          const auto written = ::pwrite( fd, data, length, off_t( offset ) );
+          if( written < 0 )
+          {
+            return false;
+          }
+          data += written;
+          length -= size_t( written );
+          offset += size_t( written );
+        }
+        return true;
+      }
+
+      /// Flush the directory holding path, making a rename within it durable.
+      ///
+      inline bool sync_directory( const std::string & path )
+      {
+        const auto slash = path.rfind( '/' );
+        const auto directory = ( slash == std::string::npos ? std::string{ "." } : path.substr( 0, std::max( slash, size_t{ 1 } ) ) );
+        const int fd = ::open( directory.c_str(), O_RDONLY | O_DIRECTORY );
+        if( fd < 0 )
+        {
+          return false;
+        }
+        const bool result = ::fsync( fd ) == 0;
+        return ( ::close( fd ) == 0 ) && result;
+      }
+    }
+
+    /// Save every worker's state to path.
+    ///
+    /// Calls function( Writer & ) once on each worker, concurrently, which must
+    /// write only state that worker owns. Must not be called from a worker.
+    ///
+    /// @return true once the checkpoint is durably in place.
+    ///
+    template < typename Exec, typename Function >
+    bool save( Exec & executor, const std::string & path, Function && function )
+    {
+      const auto workers = executor.size();
+      const auto temporary = path + ".tmp";
+      const int fd = ::open( temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+      if( fd < 0 )
+      {
+        return false;
+      }
+
+      // Serialize in parallel, then place segments and write them in parallel.
+      //
+      std::vector<Writer> writers( workers );
+      executor.each( [&]( size_t index ){ function( writers[ index ] ); } );
+
+      std::vector<Extent> extents( workers );
+      size_t offset = detail::align( sizeof( Header ) + workers * sizeof( Extent ) );
+      for( size_t index = 0; index < workers; ++index )
+      {
+        extents[ index ] = Extent{ offset, writers[ index ].size() };
+        offset = detail::align( offset + writers[ index ].size() );
+      }
+
+      std::vector<char> written( workers, false );
+      executor.each( [&]( size_t index )
+        {
+          written[ index ] = detail::pwrite( fd, writers[ index ].data(), writers[ index ].size(), size_t( extents[ index ].offset ) );
+          writers[ index ] = Writer{};
+        });
+
+      Header header;
+      std::memcpy( header.magic, magic, sizeof( magic ) );
+      header.segments = workers;
+
+      bool result = std::all_of( written.begin(), written.end(), []( char value ){ return value; } )
+        && ::ftruncate( fd, off_t( offset ) ) == 0
+        && detail::pwrite( fd, reinterpret_cast<const char *>( extents.data() ), workers * sizeof( Extent ), sizeof( Header ) )
+        && detail::pwrite( fd, reinterpret_cast<const char *>( &header ), sizeof( Header ), 0 )
+        && ::fsync( fd ) == 0;
+      result = ( ::close( fd ) == 0 ) && result;
+      result = result && std::rename( temporary.c_str(), path.c_str() ) == 0;
+      if( !result )
+      {
+        std::remove( temporary.c_str() );
+      }
+      return result && detail::sync_directory( path );
+    }
+
+    /// Restore every worker's state from path.
+    ///
+    /// Calls function( Reader & ) once on each worker, concurrently, with the
+    /// segment that worker saved. The checkpoint must have been saved by an
+    /// executor of the same size. Must not be called from a worker.
+    ///
+    /// @return false if the file is missing, malformed, sized for a different
+    ///   executor, or any reader was overrun.
+    ///
+    template < typename Exec, typename Function >
+    bool restore( Exec & executor, const std::string & path, Function && function )
+    {
+      const auto workers = executor.size();
+      const int fd = ::open( path.c_str(), O_RDONLY );
+      if( fd < 0 )
+      {
+        return false;
+      }
+
+      Header header;
+      std::vector<Extent> extents( workers );
+      bool result = ::pread( fd, &header, sizeof( header ), 0 ) == ssize_t( sizeof( header ) )
+        && std::memcmp( header.magic, magic, sizeof( magic ) ) == 0
+        && header.segments == workers
+        && ::pread( fd, extents.data(), workers * sizeof( Extent ), sizeof( Header ) ) == ssize_t( workers * sizeof( Extent ) );
+
+      if( result )
+      {
+        std::vector<char> loaded( workers, false );
+        executor.each( [&]( size_t index )
+          {
+            // Map whole pages, then skip to the segment start within them.
+            //
+            const auto & extent = extents[ index ];
+            const auto base = size_t( extent.offset ) / detail::page() * detail::page();
+            const auto skip = size_t( extent.offset ) - base;
+            Reader reader{ MappedFile{ fd, base, skip + size_t( extent.length ) }, skip, size_t( extent.length ) };
+            function( reader );
+            loaded[ index ] = reader.good();
+          });
+        result = std::all_of( loaded.begin(), loaded.end(), []( char value ){ return value; } );
+      }
+      ::close( fd );
+      return result;
+    }
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../accounting.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace rabid {
+
+  namespace detail {
+
+    /// Bump allocator for strictly nested (stack-like) lifetimes.
+    ///
+    /// Allocation advances the top of the arena; rewinding to a prior mark
+    /// releases everything allocated since. There is no per-object
+    /// deallocation, so callers must destroy objects before rewinding.
+    ///
+    /// Storage is reserved on first use, so idle arenas cost nothing, and is
+    /// charged to the reserving thread's ledger.
+    ///
+    class Arena {
+     public:
+      using Mark = size_t;
+
+      /// Create an arena with the given capacity in bytes.
+      ///
+      Arena( size_t bytes )
+      : capacity( bytes )
+      {}
+
+      Arena( Arena && other ) = default;
+
+      ~Arena()
+      {
+        if( storage )
+        {
+          accounting::refund( accounting::Kind::arena, capacity );
+        }
+      }
+
+      /// Allocate aligned storage from the arena.
+      ///
+      /// @return storage, or nullptr if the arena is exhausted.
+      ///
+      void * allocate( size_t bytes, size_t alignment )
+      {
+        if( !storage )
+        {
+          storage = std::make_unique<unsigned char[]>( capacity );
+          accounting::charge( accounting::Kind::arena, capacity );
+        }
+
+        const auto base = reinterpret_cast<uintptr_t>( storage.get() );
+        const auto offset = ( ( base + top + alignment - 1 ) & ~( alignment - 1 ) ) - base;
+        if( offset + bytes > capacity )
+        {
+          return nullptr;
+        }
+        top = offset + bytes;
+        return storage.get() + offset;
+      }
+
+      /// Query the current top of the arena.
+      ///
+      Mark mark() const { return top; }
+
+      /// Release everything allocated after the mark.
+      ///
+      void rewind( Mark mark_arg ) { top = mark_arg; }
+
+     protected:
+      std::unique_ptr<unsigned char[]> storage;
+      size_t capacity;
+      size_t top = 0;
+    };
+  }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../expected.h"
 #include "../function_traits.h"
 
 namespace rabid {
@@ -64,6 +65,45 @@ namespace rabid {
       void destruct() {}
     };
 
+    /// Test if a function takes Arg itself as its argument.
+    ///
+    template < typename Function, typename Arg, size_t nargs = function_traits<Function>::nargs >
+    struct accepts : std::is_same<std::decay_t<typename function_traits<Function>::template args<0>::type>, Arg> {};
+
+    template < typename Function, typename Arg >
+    struct accepts<Function,Arg,0> : std::false_type {};
+
+    /// Test if a continuation of Arg skips function on error.
+    ///
+    /// True when Arg is an Expected and function takes its value instead.
+    ///
+    template < typename Function, typename Arg >
+    struct propagates : std::integral_constant<bool, is_expected<Arg>::value && !accepts<Function,Arg>::value> {};
+
+    /// Result type of continuing Arg with function.
+    ///
+    /// Propagating continuations wrap their return type in an Expected with
+    /// the same error, unless it already is one.
+    ///
+    template < typename Function, typename Arg, bool = propagates<Function,Arg>::value >
+    struct continued {
+      using type = typename function_traits<Function>::return_type;
+    };
+
+    template < typename Type, typename Error >
+    struct lift { using type = Expected<Type,Error>; };
+
+    template < typename Value, typename Error >
+    struct lift<Expected<Value,Error>,Error> { using type = Expected<Value,Error>; };
+
+    template < typename Function, typename Value, typename Error >
+    struct continued<Function,Expected<Value,Error>,true> {
+      using type = typename lift<typename function_traits<Function>::return_type,Error>::type;
+    };
+
+    template < typename Function, typename Arg >
+    using continued_t = typename continued<Function,Arg>::type;
+
     /// Evaluate and capture the result of an expression(continuation style).
     ///
     /// Specialization for functions taking one argument.
@@ -73,7 +113,7 @@ namespace rabid {
       typename ArgType,
       typename Traits = function_traits<Function> >
     auto apply( Function && function, Container<ReturnType> & result, Container<ArgType> & arg )
-      -> std::enable_if_t<Traits::nargs==1>
+      -> std::enable_if_t<Traits::nargs==1 && !propagates<Function,ArgType>::value>
     {
       result.capture( std::forward<Function>( function ), arg.value() );
     }
@@ -90,5 +130,65 @@ namespace rabid {
     {
       result.capture( std::forward<Function>( function ) );
     }
+
+    /// Capture a successful result into an Expected container.
+    ///
+    template < typename Function, typename ReturnType, typename ...Args >
+    auto succeed( Function && function, Container<ReturnType> & result, Args && ...args )
+      -> std::enable_if_t<!std::is_void<typename function_traits<Function>::return_type>::value>
+    {
+      result.capture( std::forward<Function>( function ), std::forward<Args>( args )... );
+    }
+
+    template < typename Function, typename ReturnType, typename ...Args >
+    auto succeed( Function && function, Container<ReturnType> & result, Args && ...args )
+      -> std::enable_if_t<std::is_void<typename function_traits<Function>::return_type>::value>
+    {
+      function( std::forward<Args>( args )... );
+      result.construct();
+    }
+
+    /// Evaluate an expression on the value of an Expected argument.
+    ///
+    /// An error skips function and is forwarded to the result.
+    ///
+    template <typename Function,
+      typename ReturnType,
+      typename Value,
+      typename Error,
+      typename Traits = function_traits<Function> >
+    auto apply( Function && function, Container<ReturnType> & result, Container<Expected<Value,Error>> & arg )
+      -> std::enable_if_t<Traits::nargs==1 && propagates<Function,Expected<Value,Error>>::value>
+    {
+      auto & expected = arg.value();
+      if( expected )
+      {
+        succeed( std::forward<Function>( function ), result, *expected );
+      }
+      else
+      {
+        result.construct( unexpected( expected.error() ) );
+      }
+    }
+
+    /// Specialization for functions continuing an Expected<void>.
+    ///
+    template <typename Function,
+      typename ReturnType,
+      typename Error,
+      typename Traits = function_traits<Function> >
+    auto apply( Function && function, Container<ReturnType> & result, Container<Expected<void,Error>> & arg )
+      -> std::enable_if_t<Traits::nargs==0>
+    {
+      auto & expected = arg.value();
+      if( expected )
+      {
+        succeed( std::forward<Function>( function ), result );
+      }
+      else
+      {
+        result.construct( unexpected( expected.error() ) );
+      }
+    }
   }
 }
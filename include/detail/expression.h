@@ -3,6 +3,8 @@
 #include <tuple>
 
 #include "container.h"
+#include "../accounting.h"
+#include "../probes.h"
 #include "../referenced.h"
 
 namespace rabid {
@@ -214,6 +216,16 @@ namespace rabid {
         : Dispatch( std::forward<Args>( args )... )
         {}
 
+        /// Expressions allocate through accounting hooks.
+        ///
+        /// Allocation sites tag their kind via placement syntax, i.e.
+        /// new ( accounting::Kind::task ) Continuation{ ... }.
+        ///
+        static void * operator new( size_t bytes, accounting::Kind kind ) { return accounting::allocate( bytes, kind ); }
+        static void * operator new( size_t bytes ) { return accounting::allocate( bytes, accounting::Kind::continuation ); }
+        static void operator delete( void * pointer, accounting::Kind ) { accounting::deallocate( pointer ); }
+        static void operator delete( void * pointer ) { accounting::deallocate( pointer ); }
+
         /// Chain a expression after this one.
         ///
         void chain( referenced::Pointer<Expression> && expression )
@@ -240,11 +252,16 @@ namespace rabid {
           }
         }
 
+        /// Re-dispatch the expression evaluating on this thread, if any.
+        ///
         template < typename DispatchSpec >
         static void defer( DispatchSpec && dispatch )
         {
-          *static_cast<Dispatch*>( current ) = std::forward<DispatchSpec>( dispatch );
-          current = nullptr;
+          if( current )
+          {
+            *static_cast<Dispatch*>( current ) = std::forward<DispatchSpec>( dispatch );
+            current = nullptr;
+          }
         }
 
         /// Chain a expression after this one.
@@ -267,6 +284,20 @@ namespace rabid {
         ///
         bool done() { return pending.load( std::memory_order_relaxed ) == sentinel(); }
 
+        /// Replace the expression evaluating on this thread.
+        ///
+        /// Lets code that is not an expression run without being mistaken
+        /// for the expression it interrupts (i.e. by defer()).
+        ///
+        /// @return the prior expression, to restore afterwards.
+        ///
+        static Expression * swap( Expression * expression )
+        {
+          const auto prior = current;
+          current = expression;
+          return prior;
+        }
+
        protected:
         /// Head of linked list of dependant expressions
         ///
@@ -293,6 +324,7 @@ namespace rabid {
           {
             auto next = std::move( waiting->variable );
             waiting->variable = this;
+            RABID_PROBE2( continuation, this, waiting.get() );
             dispatch( std::move( waiting ) );
             waiting = std::move( next );
           }
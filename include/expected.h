@@ -0,0 +1,204 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rabid {
+
+  /// Wraps an error for constructing a failed Expected.
+  ///
+  template < typename Error >
+  struct Unexpected {
+    Error error;
+  };
+
+  template < typename Error >
+  Unexpected<std::decay_t<Error>> unexpected( Error && error )
+  {
+    return Unexpected<std::decay_t<Error>>{ std::forward<Error>( error ) };
+  }
+
+  /// Holds either a value or an error, without allocating or throwing.
+  ///
+  /// Expected results carry errors through future chains: a continuation
+  /// taking Value is skipped when its argument holds an error, and the error
+  /// is forwarded to its result. Continuations taking the Expected itself,
+  /// such as on_error stages, always run.
+  ///
+  template < typename Value, typename Error >
+  class Expected {
+   public:
+    using value_type = Value;
+    using error_type = Error;
+
+    Expected() : Expected( Value{} ) {}
+    Expected( const Value & value ) : success( true ) { new ( &storage.value ) Value( value ); }
+    Expected( Value && value ) : success( true ) { new ( &storage.value ) Value( std::move( value ) ); }
+
+    template < typename Other >
+    Expected( const Unexpected<Other> & failure ) : success( false ) { new ( &storage.error ) Error( failure.error ); }
+
+    template < typename Other >
+    Expected( Unexpected<Other> && failure ) : success( false ) { new ( &storage.error ) Error( std::move( failure.error ) ); }
+
+    Expected( const Expected & other ) : success( other.success ) { assign( other ); }
+    Expected( Expected && other ) : success( other.success ) { assign( std::move( other ) ); }
+
+    Expected & operator = ( const Expected & other )
+    {
+      if( this != &other )
+      {
+        destroy();
+        success = other.success;
+        assign( other );
+      }
+      return *this;
+    }
+
+    Expected & operator = ( Expected && other )
+    {
+      if( this != &other )
+      {
+        destroy();
+        success = other.success;
+        assign( std::move( other ) );
+      }
+      return *this;
+    }
+
+    ~Expected() { destroy(); }
+
+    bool has_value() const { return success; }
+    explicit operator bool () const { return success; }
+
+    /// Access the value. Only valid if has_value().
+    ///
+    Value & value() { return storage.value; }
+    const Value & value() const { return storage.value; }
+    Value & operator * () { return storage.value; }
+    const Value & operator * () const { return storage.value; }
+    Value * operator -> () { return &storage.value; }
+    const Value * operator -> () const { return &storage.value; }
+
+    /// Access the error. Only valid if !has_value().
+    ///
+    Error & error() { return storage.error; }
+    const Error & error() const { return storage.error; }
+
+   protected:
+    union Storage {
+      Storage() {}
+      ~Storage() {}
+      Value value;
+      Error error;
+    } storage;
+    bool success;
+
+    template < typename Other >
+    void assign( Other && other )
+    {
+      if( success )
+      {
+        new ( &storage.value ) Value( std::forward<Other>( other ).storage.value );
+      }
+      else
+      {
+        new ( &storage.error ) Error( std::forward<Other>( other ).storage.error );
+      }
+    }
+
+    void destroy()
+    {
+      if( success )
+      {
+        storage.value.~Value();
+      }
+      else
+      {
+        storage.error.~Error();
+      }
+    }
+  };
+
+  /// Specialization for void--omits value access.
+  ///
+  template < typename Error >
+  class Expected<void,Error> {
+   public:
+    using value_type = void;
+    using error_type = Error;
+
+    Expected() : success( true ) {}
+
+    template < typename Other >
+    Expected( const Unexpected<Other> & failure ) : success( false ) { new ( &storage.error ) Error( failure.error ); }
+
+    template < typename Other >
+    Expected( Unexpected<Other> && failure ) : success( false ) { new ( &storage.error ) Error( std::move( failure.error ) ); }
+
+    Expected( const Expected & other ) : success( other.success ) { assign( other ); }
+    Expected( Expected && other ) : success( other.success ) { assign( std::move( other ) ); }
+
+    Expected & operator = ( const Expected & other )
+    {
+      if( this != &other )
+      {
+        destroy();
+        success = other.success;
+        assign( other );
+      }
+      return *this;
+    }
+
+    Expected & operator = ( Expected && other )
+    {
+      if( this != &other )
+      {
+        destroy();
+        success = other.success;
+        assign( std::move( other ) );
+      }
+      return *this;
+    }
+
+    ~Expected() { destroy(); }
+
+    bool has_value() const { return success; }
+    explicit operator bool () const { return success; }
+
+    Error & error() { return storage.error; }
+    const Error & error() const { return storage.error; }
+
+   protected:
+    union Storage {
+      Storage() {}
+      ~Storage() {}
+      Error error;
+    } storage;
+    bool success;
+
+    template < typename Other >
+    void assign( Other && other )
+    {
+      if( !success )
+      {
+        new ( &storage.error ) Error( std::forward<Other>( other ).storage.error );
+      }
+    }
+
+    void destroy()
+    {
+      if( !success )
+      {
+        storage.error.~Error();
+      }
+    }
+  };
+
+  template < typename Type >
+  struct is_expected : std::false_type {};
+
+  template < typename Value, typename Error >
+  struct is_expected<Expected<Value,Error>> : std::true_type {};
+}
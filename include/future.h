@@ -5,6 +5,51 @@
 
 namespace rabid {
 
+  namespace detail {
+
+    /// Continuation handling the error of an Expected.
+    ///
+    /// Values pass through. Errors go to handler, which either returns a
+    /// replacement convertible to the Expected, or returns void to observe
+    /// the error and pass it on.
+    ///
+    template < typename Handler, typename Value >
+    struct Recover {
+      static_assert( is_expected<Value>::value, "on_error requires an Expected value" );
+    };
+
+    template < typename Handler, typename Value, typename Error >
+    struct Recover<Handler,Expected<Value,Error>> {
+      Expected<Value,Error> operator()( Expected<Value,Error> & expected )
+      {
+        if( expected )
+        {
+          return expected;
+        }
+        return recover( expected.error(), std::is_void<typename function_traits<Handler>::return_type>{} );
+      }
+
+      Expected<Value,Error> recover( Error & error, std::true_type )
+      {
+        handler( error );
+        return unexpected( error );
+      }
+
+      Expected<Value,Error> recover( Error & error, std::false_type )
+      {
+        return handler( error );
+      }
+
+      Handler handler;
+    };
+  }
+
+  /// Futures chain continuations on a value.
+  ///
+  /// Values that are Expected carry errors down the chain: then() stages
+  /// taking the value are skipped while an error propagates, and on_error()
+  /// stages handle it.
+  ///
   template < typename Value, typename Dispatch = detail::expression::ImmediateDispatch >
   class Future {
    public:
@@ -14,24 +59,36 @@ namespace rabid {
 
     template < typename Function >
     auto then( Function && function ) const
-      -> Future<typename function_traits<Function>::return_type, Dispatch>
+      -> Future<detail::continued_t<Function,Value>, Dispatch>
     {
-      using Result = typename function_traits<Function>::return_type;
-      referenced::Pointer<Concept> result{ new Expression<Function,Value,Result>{ static_cast<Dispatch&>( *value ), std::forward<Function>( function ) } };
+      using Result = detail::continued_t<Function,Value>;
+      referenced::Pointer<Concept> result{ new ( accounting::Kind::continuation ) Expression<Function,Value,Result>{ static_cast<Dispatch&>( *value ), std::forward<Function>( function ) } };
       value->chain( result );
       return result;
     }
 
     template < typename DispatchSpec, typename Function >
     auto then( DispatchSpec && dispatch, Function && function ) const
-      -> Future<typename function_traits<Function>::return_type, Dispatch>
+      -> Future<detail::continued_t<Function,Value>, Dispatch>
     {
-      using Result = typename function_traits<Function>::return_type;
-      referenced::Pointer<Concept> result{ new Expression<Function,Value,Result>{ std::forward<DispatchSpec>( dispatch ), std::forward<Function>( function ) } };
+      using Result = detail::continued_t<Function,Value>;
+      referenced::Pointer<Concept> result{ new ( accounting::Kind::continuation ) Expression<Function,Value,Result>{ std::forward<DispatchSpec>( dispatch ), std::forward<Function>( function ) } };
       value->chain( result );
       return result;
     }
 
+    template < typename Handler >
+    Future<Value, Dispatch> on_error( Handler && handler ) const
+    {
+      return then( detail::Recover<std::decay_t<Handler>,Value>{ std::forward<Handler>( handler ) } );
+    }
+
+    template < typename DispatchSpec, typename Handler >
+    Future<Value, Dispatch> on_error( DispatchSpec && dispatch, Handler && handler ) const
+    {
+      return then( std::forward<DispatchSpec>( dispatch ), detail::Recover<std::decay_t<Handler>,Value>{ std::forward<Handler>( handler ) } );
+    }
+
     Future( referenced::Pointer<Concept> && coupling )
     : value( std::move( coupling ) )
     {}
@@ -50,24 +107,36 @@ namespace rabid {
 
     template < typename Function >
     auto then( Function && function )
-      -> Future<typename function_traits<Function>::return_type, Dispatch>
+      -> Future<detail::continued_t<Function,Value>, Dispatch>
     {
-      using Result = typename function_traits<Function>::return_type;
-      referenced::Pointer<Concept> result{ new Expression<Function,Value,Result>{ static_cast<Dispatch&>( *value ), std::forward<Function>( function ) } };
+      using Result = detail::continued_t<Function,Value>;
+      referenced::Pointer<Concept> result{ new ( accounting::Kind::continuation ) Expression<Function,Value,Result>{ static_cast<Dispatch&>( *value ), std::forward<Function>( function ) } };
       value->chain( result );
       return result;
     }
 
     template < typename DispatchSpec, typename Function >
     auto then( DispatchSpec && dispatch, Function && function ) const
-      -> Future<typename function_traits<Function>::return_type, Dispatch>
+      -> Future<detail::continued_t<Function,Value>, Dispatch>
     {
-      using Result = typename function_traits<Function>::return_type;
-      referenced::Pointer<Concept> result{ new Expression<Function,Value,Result>{ std::forward<DispatchSpec>( dispatch ), std::forward<Function>( function ) } };
+      using Result = detail::continued_t<Function,Value>;
+      referenced::Pointer<Concept> result{ new ( accounting::Kind::continuation ) Expression<Function,Value,Result>{ std::forward<DispatchSpec>( dispatch ), std::forward<Function>( function ) } };
       value->chain( result );
       return result;
     }
 
+    template < typename Handler >
+    Future<Value, Dispatch> on_error( Handler && handler )
+    {
+      return then( detail::Recover<std::decay_t<Handler>,Value>{ std::forward<Handler>( handler ) } );
+    }
+
+    template < typename DispatchSpec, typename Handler >
+    Future<Value, Dispatch> on_error( DispatchSpec && dispatch, Handler && handler ) const
+    {
+      return then( std::forward<DispatchSpec>( dispatch ), detail::Recover<std::decay_t<Handler>,Value>{ std::forward<Handler>( handler ) } );
+    }
+
     template < typename ...Args >
     void complete( Args && ... args )
     {
@@ -76,12 +145,12 @@ namespace rabid {
     }
 
     Promise()
-    : value( new Argument{} )
+    : value( new ( accounting::Kind::promise ) Argument{} )
     {}
 
     template < typename DispatchSpec >
     Promise( DispatchSpec && dispatch )
-    : value( new Argument{ std::forward<DispatchSpec>( dispatch ) } )
+    : value( new ( accounting::Kind::promise ) Argument{ std::forward<DispatchSpec>( dispatch ) } )
     {}
 
    protected:
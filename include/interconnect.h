@@ -1,7 +1,14 @@
 #pragma once
+#include "accounting.h"
 #include "intrusive.h"
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
 #include <vector>
 
 namespace rabid {
@@ -24,10 +31,16 @@ namespace rabid {
 
   namespace interconnect {
 
+    /// Base class for anything sent through an interconnect.
+    ///
+    /// The address is kept to 32 bits, leaving the remainder of the word as
+    /// spare header space for the recipient. Executor uses it to carry sampled
+    /// send timestamps (zero when unsampled).
+    ///
     struct Message : intrusive::Link< Message, tagged_pointer_bits<3>::type >
     {
       Message( size_t index ) noexcept
-      : address( index )
+      : address( static_cast<std::uint32_t>( index ) )
       {}
 
       struct Unaddressed {};
@@ -37,7 +50,8 @@ namespace rabid {
         next() = nullptr;
       }
 
-      size_t address;
+      std::uint32_t address;
+      std::uint32_t stamp = 0;
     };
 
     using Buffer = detail::CacheAligned< intrusive::Exchange<Message> >;
@@ -59,6 +73,10 @@ namespace rabid {
       }
 
       Batch receive( const Message::PointerType & message ) const { return local.clear( message ); }
+
+      /// Observe the newest inbound message without receiving it.
+      ///
+      Message::PointerType peek() const { return local.peek(); }
       
       constexpr Connection reverse() const { return Connection{ local, remote }; }
 
@@ -72,6 +90,106 @@ namespace rabid {
       Buffer & local;
     };
 
+    /// Flat-combining fan-in for a buffer with many concurrent senders.
+    ///
+    /// Each sender deposits messages in its own slot, then tries to become
+    /// the combiner. The combiner drains every slot and splices the messages
+    /// into the destination with a single insert, so the destination's head
+    /// sees one CAS per combine rather than one per message, and retries stay
+    /// flat as senders grow. Senders that lose the election return at once;
+    /// the combiner re-checks the slots after stepping down, so no deposit is
+    /// stranded.
+    ///
+    /// Direct already gives every sender its own buffer. Combining is meant
+    /// for buffers that are shared anyway, like one filled by threads outside
+    /// an executor.
+    ///
+    class Combining {
+     public:
+      /// @param destination buffer receiving the combined messages.
+      /// @param senders number of sender slots; senders index them in [0,n).
+      ///
+      Combining( Buffer & destination_arg, size_t senders )
+      : destination( destination_arg )
+      , slots( std::make_unique<Buffer[]>( senders ) )
+      , count( senders )
+      {}
+
+      /// Deposit a message, combining all deposits if no one else is.
+      ///
+      /// prepare is applied to the destination's head as by Exchange::insert,
+      /// once per attempt of whichever sender combines.
+      ///
+      template < typename Prepare >
+      void send( size_t sender, const Message::PointerType & message, Prepare && prepare )
+      {
+        slots[ sender ].insert( message, []( const Message::PointerType & prior ){ return prior; } );
+
+        // Pairs with the combiner's fence: either it sees this deposit when
+        // re-checking, or this sender sees it step down and combines.
+        //
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        while( !combining.exchange( true, std::memory_order_acquire ) )
+        {
+          combine( prepare );
+          combining.store( false, std::memory_order_release );
+          std::atomic_thread_fence( std::memory_order_seq_cst );
+          if( !pending() )
+          {
+            break;
+          }
+        }
+      }
+
+     protected:
+      template < typename Prepare >
+      void combine( Prepare & prepare )
+      {
+        Message::PointerType first{ nullptr };
+        Message::PointerType last{ nullptr };
+        for( size_t index = 0; index < count; ++index )
+        {
+          auto batch = slots[ index ].clear();
+          if( batch.empty() )
+          {
+            continue;
+          }
+          auto tail = batch.begin();
+          while( tail->next() != nullptr )
+          {
+            tail = tail->next();
+          }
+          tail->next() = first;
+          first = batch.begin();
+          if( last == nullptr )
+          {
+            last = tail;
+          }
+        }
+        if( first != nullptr )
+        {
+          destination.insert( first, last, prepare );
+        }
+      }
+
+      bool pending() const
+      {
+        for( size_t index = 0; index < count; ++index )
+        {
+          if( slots[ index ].peek() != nullptr )
+          {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      Buffer & destination;
+      std::unique_ptr<Buffer[]> slots;
+      const size_t count;
+      alignas(64) std::atomic<bool> combining{ false };
+    };
+
     template < typename AddressMap >
     class Node : protected AddressMap {
      public:
@@ -87,29 +205,73 @@ namespace rabid {
       , connections( std::move( connections_arg ) )
       {}
 
+      /// Receive all pending messages, forwarding non-terminal ones.
+      ///
+      /// Terminal messages are handed to agent.receive( message, index ),
+      /// where index identifies the inbound connection.
+      ///
+      /// Non-terminal messages are grouped by next hop over the sweep, then
+      /// each group is spliced onto its connection with a single insert,
+      /// using one agent.preparer() per group. Multi-hop traffic therefore
+      /// costs one atomic per group per hop, rather than one per message.
+      /// Groups are allocated on first forward, so single-hop topologies
+      /// never pay for them.
+      ///
       template < typename Agent >
       void operate( Agent && agent ) const
       {
-        for( auto & connection :connections )
+        bool forwarded = false;
+        for( size_t index = 0; index < connections.size(); ++index )
         {
-          auto batch = connection.receive( agent.sentinel() );
+          auto batch = connections[ index ].receive( agent.sentinel() );
           while( !batch.empty() )
           {
             const auto message = batch.remove();
             if( AddressMap::terminal( message ) )
             {
-              agent.receive( message );
+              agent.receive( message, index );
             }
             else
             {
-              send( message, agent.preparer() );
+              if( outgoing.empty() )
+              {
+                outgoing.resize( connections.size() );
+              }
+              outgoing[ AddressMap::operator()( message->address ) ].insert( message );
+              forwarded = true;
             }
           }
         }
+        if( forwarded )
+        {
+          forward( agent );
+        }
+      }
+
+      /// Query if any inbound connection holds a message accepted by filter.
+      ///
+      /// Only the newest message of each connection is inspected, so filter
+      /// should distinguish real messages from sentinels left by operate().
+      ///
+      template < typename Filter >
+      bool pending( Filter && filter ) const
+      {
+        return std::any_of( connections.begin(), connections.end(), [&filter]( const Connection & connection )
+          {
+            const auto message = connection.peek();
+            return message.get() != nullptr && filter( message );
+          });
       }
 
       const std::vector<Connection> & all() const { return connections; }
 
+      /// Query the number of bytes allocated for connections and forwarding.
+      ///
+      size_t footprint() const
+      {
+        return connections.capacity() * sizeof( Connection ) + outgoing.capacity() * sizeof( Group );
+      }
+
       template < typename MessageHandler >
       void clear( MessageHandler && handler ) const
       {
@@ -124,8 +286,45 @@ namespace rabid {
       }
 
      protected:
+      /// Messages collected for one next hop, linked first to last.
+      ///
+      struct Group {
+        Message::PointerType first{ nullptr };
+        Message::PointerType last{ nullptr };
+
+        void insert( const Message::PointerType & message )
+        {
+          message->next() = first;
+          first = message;
+          if( last == nullptr )
+          {
+            last = message;
+          }
+        }
+      };
+
+      template < typename Agent >
+      void forward( Agent & agent ) const
+      {
+        for( size_t index = 0; index < outgoing.size(); ++index )
+        {
+          auto & group = outgoing[ index ];
+          if( group.first != nullptr )
+          {
+            connections[ index ].send( group.first, group.last, agent.preparer() );
+            group = Group{};
+          }
+        }
+      }
+
       const Connection & route( const Message & message ) const { return connections[ AddressMap::operator()( message.address ) ]; }
       std::vector<Connection> connections;
+
+      /// Forwarding groups per outbound connection, empty until the first
+      /// forward. Only touched by operate(), which is only called from the
+      /// node's own thread.
+      ///
+      mutable std::vector<Group> outgoing;
     };
 
     struct Identity {
@@ -136,13 +335,81 @@ namespace rabid {
       static bool terminal( const Type & ) { return true; }
     };
 
+    /// Process-wide pool of buffer arrays, reused across interconnects.
+    ///
+    /// Arrays are kept per size when released and handed back empty by the
+    /// next acquire of that size, so rebuilding an interconnect of the same
+    /// shape does not touch the allocator. Pooled arrays live until exit.
+    ///
+    class Pool {
+     public:
+      /// Deleter returning an array to the pool.
+      ///
+      struct Release {
+        size_t count;
+        void operator() ( Buffer * buffers ) const { instance().release( buffers, count ); }
+      };
+
+      using Pointer = std::unique_ptr<Buffer[], Release>;
+
+      /// Acquire an array of count empty buffers.
+      ///
+      static Pointer acquire( size_t count ) { return instance().take( count ); }
+
+     protected:
+      static_assert( std::is_trivially_destructible<Buffer>::value, "Pooled buffers are reset in place" );
+
+      static Pool & instance()
+      {
+        static Pool pool;
+        return pool;
+      }
+
+      Pointer take( size_t count )
+      {
+        std::unique_ptr<Buffer[]> buffers;
+        {
+          std::lock_guard<std::mutex> lock{ mutex };
+          auto & free = arrays[ count ];
+          if( !free.empty() )
+          {
+            buffers = std::move( free.back() );
+            free.pop_back();
+          }
+        }
+
+        if( buffers )
+        {
+          for( size_t index = 0; index < count; ++index )
+          {
+            new ( &buffers[ index ] ) Buffer{};
+          }
+        }
+        else
+        {
+          buffers = std::make_unique<Buffer[]>( count );
+        }
+        return Pointer{ buffers.release(), Release{ count } };
+      }
+
+      void release( Buffer * buffers, size_t count )
+      {
+        std::lock_guard<std::mutex> lock{ mutex };
+        arrays[ count ].emplace_back( buffers );
+      }
+
+      std::mutex mutex;
+      std::map<size_t, std::vector<std::unique_ptr<Buffer[]>>> arrays;
+    };
+
     class Direct {
      public:
       using NodeType = Node<Identity>;
       const NodeType & node( size_t index ) const { return nodes[ index ]; }
 
       Direct( size_t count )
-      : buffers( std::make_unique<Buffer[]>( (count -1 ) * count + count ) )
+      : buffers( Pool::acquire( (count -1 ) * count + count ) )
+      , charge( accounting::Kind::buffer, count * count * sizeof( Buffer ) )
       {
         nodes.reserve( count );
         for( size_t node_index = 0; node_index < count; ++node_index )
@@ -159,7 +426,20 @@ namespace rabid {
           nodes.emplace_back( std::move( connections ) );
         }
       }
-      
+
+      /// Query the number of bytes allocated for buffers, connections and
+      /// forwarding groups.
+      ///
+      size_t footprint() const
+      {
+        size_t bytes = nodes.capacity() * nodes.capacity() * sizeof( Buffer );
+        for( auto & node : nodes )
+        {
+          bytes += node.footprint();
+        }
+        return bytes;
+      }
+
      protected:
       Buffer & buffer_for_edge( size_t src, size_t dst ) const
       {
@@ -198,7 +478,8 @@ namespace rabid {
       }
 
       std::vector<NodeType> nodes;
-      std::unique_ptr<Buffer[]> buffers;
+      Pool::Pointer buffers;
+      accounting::Charge charge;
     };
   }
 }
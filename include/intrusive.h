@@ -219,6 +219,10 @@ namespace rabid {
         return List<Link>{ head.exchange( value, std::memory_order_acq_rel ) };
       }
 
+      /// Observe the most recently inserted link without removing anything.
+      ///
+      LinkPointer peek() const { return head.load( std::memory_order_acquire ); }
+
       template < typename Prepare >
       void insert( const LinkPointer & link, Prepare && prepare )
       {
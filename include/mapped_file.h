@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+namespace rabid {
+
+  /// Read-only memory mapping of a file.
+  ///
+  class MappedFile {
+   public:
+    MappedFile() = default;
+
+    template < typename ...Args>
+    MappedFile( Args && ...args )
+    {
+      open( std::forward<Args>( args )... );
+    }
+
+    ~MappedFile() { close(); }
+
+    MappedFile( const MappedFile & ) = delete;
+    MappedFile( MappedFile && other )
+    : base( other.base )
+    , bytes( other.bytes )
+    {
+      other.base = nullptr;
+      other.bytes = 0;
+    }
+
+    MappedFile & operator = ( const MappedFile & ) = delete;
+    MappedFile & operator = ( MappedFile && other )
+    {
+      close();
+      base = other.base;
+      bytes = other.bytes;
+      other.base = nullptr;
+      other.bytes = 0;
+      return *this;
+    }
+
+    bool open( const std::string & path, size_t offset = 0, size_t length = std::numeric_limits<size_t>::max() )
+    {
+      int fd = ::open( path.c_str(), O_RDONLY );
+      if( fd >= 0 )
+      {
+        bool result = open( fd, offset, length );
+        ::close( fd ); 
+        return result;
+      }
+      return false;
+    }
+
+    bool open( const int fd, size_t offset = 0, size_t length = std::numeric_limits<size_t>::max() )
+    {
+        struct stat stat;
+        if( 0 == ::fstat( fd, &stat ) )
+        {
+          offset = std::min( offset, size_t(stat.st_size) );
+          length = std::min( length, size_t(stat.st_size) - offset );
+
+          close();
+
+          base = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, fd, off_t(offset) );
+          if( base == MAP_FAILED )
+          {
+            base = nullptr;
+          }
+          else
+          {
+            bytes = length;
+            return true;
+          }
+        }
+        return false;
+    }
+
+    void close()
+    {
+      if( base )
+      {
+        ::munmap( base, bytes );
+        base = nullptr;
+        bytes = 0;
+      }
+    }
+
+    size_t warm() const
+    {
+      size_t total = 0;
+      for( size_t index = 0; index < size<uint8_t>(); ++index )
+      {
+        total += array<uint8_t>()[ index ];
+      }
+      return total;
+    }
+
+    bool empty() const { return base == nullptr || bytes == 0; }
+
+    template < typename T >
+    size_t size() const { return bytes/sizeof(T); }
+
+    template < typename T >
+    const T * array() const { return reinterpret_cast<const T*>( base ); }
+
+   protected:
+    void * base = nullptr;
+    size_t bytes = 0;
+  };
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "Executor.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace rabid {
+
+  /// Range-partitioned ordered containers.
+  ///
+  namespace ordered {
+
+    /// Choose splitters dividing sampled keys into equal-sized ranges.
+    ///
+    /// @return workers - 1 sorted keys; worker i owns keys in
+    ///   [ splitters[ i - 1 ], splitters[ i ] ).
+    ///
+    template < typename Key, typename Compare = std::less<Key> >
+    std::vector<Key> splitters( std::vector<Key> sample, size_t workers, Compare compare = Compare{} )
+    {
+      std::sort( sample.begin(), sample.end(), compare );
+      std::vector<Key> result;
+      for( size_t index = 1; index < workers && !sample.empty(); ++index )
+      {
+        result.push_back( sample[ index * sample.size() / workers ] );
+      }
+      return result;
+    }
+
+    /// Ordered map sharded across an Executor's workers by key range.
+    ///
+    /// Each worker owns a contiguous key range, held as a sorted flat map.
+    /// Inserts append to an unsorted tail that is sorted and merged in once it
+    /// grows past a fraction of the map, or before any read. Point operations
+    /// go to the one owner of their key; range scans go only to the owners
+    /// overlapping the range.
+    ///
+    /// Owners' ranges are disjoint and ordered, so merging their sorted scan
+    /// results reduces to concatenating them in owner order on the requester.
+    ///
+    /// Other than load(), operations must be called from a worker, and
+    /// complete asynchronously on the calling worker.
+    ///
+    template < typename Exec, typename Key, typename Value, typename Compare = std::less<Key> >
+    class Map {
+     public:
+      using Entry = std::pair<Key,Value>;
+
+      Map( size_t workers, std::vector<Key> splitters_arg, Compare compare_arg = Compare{} )
+      : splitters( std::move( splitters_arg ) )
+      , compare( std::move( compare_arg ) )
+      , shards( std::make_unique<Shard[]>( workers ) )
+      {
+        std::sort( splitters.begin(), splitters.end(), compare );
+        splitters.resize( std::min( splitters.size(), workers ? workers - 1 : 0 ) );
+        for( size_t index = 0; index < workers; ++index )
+        {
+          shards[ index ].compare = compare;
+        }
+      }
+
+      /// Query the worker owning key.
+      ///
+      size_t owner( const Key & key ) const
+      {
+        return size_t( std::upper_bound( splitters.begin(), splitters.end(), key, compare ) - splitters.begin() );
+      }
+
+      /// Insert entries from outside the executor, in parallel per owner.
+      ///
+      /// Blocks until every owner has merged its entries.
+      ///
+      void load( Exec & executor, const std::vector<Entry> & entries )
+      {
+        std::vector<std::vector<Entry>> parts( executor.size() );
+        for( auto & entry : entries )
+        {
+          parts[ owner( entry.first ) ].push_back( entry );
+        }
+
+        executor.each( [this,&parts]( size_t index )
+          {
+            auto & shard = shards[ index ];
+            for( auto & entry : parts[ index ] )
+            {
+              shard.insert( std::move( entry ) );
+            }
+            shard.settle();
+          });
+      }
+
+      /// Insert or replace an entry on its owner.
+      ///
+      void insert( Key key, Value value )
+      {
+        Exec::async( owner( key ), [this,entry = Entry{ std::move( key ), std::move( value ) }]
+          {
+            shards[ Exec::current() ].insert( entry );
+          });
+      }
+
+      /// Look up key, then call done( const Value * ) on this worker.
+      ///
+      /// The pointer is nullptr if key is absent, and valid only during done.
+      ///
+      template < typename Done >
+      void find( Key key, Done && done )
+      {
+        const auto requester = Exec::current();
+        Exec::async( owner( key ), [this,requester,key = std::move( key ),done = std::forward<Done>( done )]
+          {
+            auto & shard = shards[ Exec::current() ];
+            shard.settle();
+            const auto found = std::lower_bound( shard.sorted.begin(), shard.sorted.end(), key, shard.before() );
+            const bool present = ( found != shard.sorted.end() && !compare( key, found->first ) );
+            Exec::async( requester, [value = ( present ? found->second : Value{} ),present,done]
+              {
+                done( present ? &value : nullptr );
+              });
+          });
+      }
+
+      /// Scan keys in [ first, last ), then call done( std::vector<Entry> & )
+      /// on this worker with the entries in key order.
+      ///
+      template < typename Done >
+      void scan( Key first, Key last, Done && done )
+      {
+        struct Gather {
+          std::vector<std::vector<Entry>> parts;
+          size_t pending;
+          typename std::decay<Done>::type done;
+        };
+
+        if( !compare( first, last ) )
+        {
+          std::vector<Entry> empty;
+          done( empty );
+          return;
+        }
+
+        // Owners of keys below last; a range ending on a splitter excludes
+        // the owner that splitter starts.
+        //
+        const auto low = owner( first );
+        const auto high = size_t( std::lower_bound( splitters.begin(), splitters.end(), last, compare ) - splitters.begin() );
+        const auto requester = Exec::current();
+        const auto gather = std::make_shared<Gather>( Gather{ std::vector<std::vector<Entry>>( high - low + 1 ), high - low + 1, std::forward<Done>( done ) } );
+
+        for( auto index = low; index <= high; ++index )
+        {
+          Exec::async( index, [this,gather,first,last,requester,part = index - low]
+            {
+              auto & shard = shards[ Exec::current() ];
+              shard.settle();
+              const auto begin = std::lower_bound( shard.sorted.begin(), shard.sorted.end(), first, shard.before() );
+              const auto end = std::lower_bound( begin, shard.sorted.end(), last, shard.before() );
+              std::vector<Entry> entries{ begin, end };
+
+              Exec::async( requester, [gather,part,entries = std::move( entries )]() mutable
+                {
+                  gather->parts[ part ] = std::move( entries );
+                  if( --gather->pending == 0 )
+                  {
+                    auto & result = gather->parts.front();
+                    for( size_t other = 1; other < gather->parts.size(); ++other )
+                    {
+                      result.insert( result.end(), std::make_move_iterator( gather->parts[ other ].begin() ), std::make_move_iterator( gather->parts[ other ].end() ) );
+                    }
+                    gather->done( result );
+                  }
+                });
+            });
+        }
+      }
+
+     protected:
+      struct alignas(64) Shard {
+        Compare compare;
+        std::vector<Entry> sorted;
+        std::vector<Entry> pending;
+
+        /// Entry-to-key ordering for searches.
+        ///
+        auto before() const
+        {
+          return [this]( const Entry & entry, const Key & key ){ return compare( entry.first, key ); };
+        }
+
+        void insert( Entry entry )
+        {
+          pending.push_back( std::move( entry ) );
+          if( pending.size() > std::max( sorted.size() / 8, size_t( 64 ) ) )
+          {
+            settle();
+          }
+        }
+
+        /// Merge pending entries into the sorted map; later inserts win.
+        ///
+        void settle()
+        {
+          if( pending.empty() )
+          {
+            return;
+          }
+          const auto less = [this]( const Entry & a, const Entry & b ){ return compare( a.first, b.first ); };
+          std::stable_sort( pending.begin(), pending.end(), less );
+
+          std::vector<Entry> merged;
+          merged.reserve( sorted.size() + pending.size() );
+          auto old = sorted.begin();
+          for( auto current = pending.begin(); current != pending.end(); ++current )
+          {
+            if( current + 1 != pending.end() && !less( *current, *( current + 1 ) ) )
+            {
+              continue;
+            }
+            while( old != sorted.end() && less( *old, *current ) )
+            {
+              merged.push_back( std::move( *old++ ) );
+            }
+            if( old != sorted.end() && !less( *current, *old ) )
+            {
+              ++old;
+            }
+            merged.push_back( std::move( *current ) );
+          }
+          merged.insert( merged.end(), std::make_move_iterator( old ), std::make_move_iterator( sorted.end() ) );
+
+          sorted = std::move( merged );
+          pending.clear();
+        }
+      };
+
+      std::vector<Key> splitters;
+      Compare compare;
+      std::unique_ptr<Shard[]> shards;
+    };
+  }
+}
@@ -0,0 +1,480 @@
+#pragma once
+
+#include "Executor.h"
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rabid {
+
+  /// Lazy parallel range pipelines.
+  ///
+  /// A pipeline is a source followed by per-element stages and optional
+  /// repartitioning boundaries:
+  ///
+  ///   auto counts = pipeline::parallel( chunks )
+  ///     | pipeline::flat_map<Token<char>>( tokenize )
+  ///     | pipeline::filter( interesting )
+  ///     | pipeline::group_by( key, size_t( 0 ), count );
+  ///
+  ///   auto result = counts.collect( executor );
+  ///
+  /// Nothing runs until a terminal (run, for_each or collect) is called.
+  /// Adjacent per-element stages are then fused by nesting them into a single
+  /// sink per worker, so each element flows from the source through every
+  /// stage in one loop without intermediate storage. Elements only cross the
+  /// interconnect at group_by(), which routes them in batches to the worker
+  /// owning their key; each worker then feeds its groups into the next run of
+  /// fused stages.
+  ///
+  /// Terminals must be called from outside the executor, and block until the
+  /// whole pipeline has drained.
+  ///
+  namespace pipeline {
+
+    namespace detail {
+
+      using rabid::detail::Counter;
+
+      /// Element type as stored in a container, i.e. map entries lose const.
+      ///
+      template < typename T >
+      struct Stored { using type = T; };
+
+      template < typename Key, typename Value >
+      struct Stored<std::pair<const Key, Value>> { using type = std::pair<Key,Value>; };
+
+      /// Stage that passes elements through unchanged.
+      ///
+      struct Identity {
+        template < typename In >
+        using output = In;
+
+        template < typename Sink >
+        Sink bind( Sink sink ) const { return sink; }
+      };
+
+      /// Two stages fused into one.
+      ///
+      template < typename First, typename Second >
+      struct Compose {
+        First first;
+        Second second;
+
+        template < typename In >
+        using output = typename Second::template output<typename First::template output<In>>;
+
+        template < typename Sink >
+        auto bind( Sink sink ) const { return first.bind( second.bind( std::move( sink ) ) ); }
+      };
+
+      template < typename Function, typename Next >
+      struct TransformSink {
+        Function function;
+        Next next;
+
+        template < typename T >
+        void operator()( T && value ) { next( function( std::forward<T>( value ) ) ); }
+        void finish() { next.finish(); }
+      };
+
+      template < typename Function >
+      struct Transform {
+        Function function;
+
+        template < typename In >
+        using output = typename std::decay<typename std::result_of<const Function &( const In & )>::type>::type;
+
+        template < typename Sink >
+        TransformSink<Function,Sink> bind( Sink sink ) const { return { function, std::move( sink ) }; }
+      };
+
+      template < typename Predicate, typename Next >
+      struct FilterSink {
+        Predicate predicate;
+        Next next;
+
+        template < typename T >
+        void operator()( T && value )
+        {
+          if( predicate( value ) )
+          {
+            next( std::forward<T>( value ) );
+          }
+        }
+        void finish() { next.finish(); }
+      };
+
+      template < typename Predicate >
+      struct Filter {
+        Predicate predicate;
+
+        template < typename In >
+        using output = In;
+
+        template < typename Sink >
+        FilterSink<Predicate,Sink> bind( Sink sink ) const { return { predicate, std::move( sink ) }; }
+      };
+
+      template < typename Function, typename Next >
+      struct FlatMapSink {
+        Function function;
+        Next next;
+
+        template < typename T >
+        void operator()( T && value )
+        {
+          function( std::forward<T>( value ), [this]( auto && output ){ next( std::forward<decltype( output )>( output ) ); } );
+        }
+        void finish() { next.finish(); }
+      };
+
+      template < typename Out, typename Function >
+      struct FlatMap {
+        Function function;
+
+        template < typename In >
+        using output = Out;
+
+        template < typename Sink >
+        FlatMapSink<Function,Sink> bind( Sink sink ) const { return { function, std::move( sink ) }; }
+      };
+
+      /// Pending group_by() boundary.
+      ///
+      template < typename KeyFunction, typename Accumulator, typename Reducer, typename Hash >
+      struct GroupBy {
+        KeyFunction key;
+        Accumulator initial;
+        Reducer reducer;
+        size_t batch;
+      };
+
+      /// Terminal sink calling a function on each element.
+      ///
+      template < typename Function >
+      struct ForEachSink {
+        Function & function;
+
+        template < typename T >
+        void operator()( T && value ) { function( std::forward<T>( value ) ); }
+        void finish() {}
+      };
+
+      /// Source over a vector of items, split adaptively across workers.
+      ///
+      template < typename T >
+      class Parallel {
+       public:
+        using value_type = T;
+
+        Parallel( std::vector<T> items_arg, size_t grain_arg )
+        : items( std::move( items_arg ) )
+        , grain( grain_arg )
+        {}
+
+        /// Feed every item to some worker's sink, then finish every sink.
+        ///
+        template < typename Exec, typename Sinks >
+        void drive( Exec & executor, Sinks & sinks, Counter & counter )
+        {
+          counter.reset( 1 );
+          executor.wake();
+          executor.inject( 0, [this,&sinks,&counter]
+            {
+              Exec::split( 0, items.size(), grain, [this,&sinks]( size_t first, size_t last )
+                {
+                  auto & sink = sinks[ Exec::current() ];
+                  for( ; first < last; ++first )
+                  {
+                    sink( items[ first ] );
+                  }
+                },
+                [&sinks,&counter]
+                {
+                  for( size_t index = 0; index < Exec::concurrency(); ++index )
+                  {
+                    counter.increment();
+                    Exec::async( index, [&sinks,&counter]
+                      {
+                        sinks[ Exec::current() ].finish();
+                        counter.decrement();
+                      });
+                  }
+                  counter.decrement();
+                });
+            });
+          counter.wait();
+        }
+
+       protected:
+        std::vector<T> items;
+        size_t grain;
+      };
+    }
+
+    /// A source followed by fused stages.
+    ///
+    template < typename Source, typename Stages = detail::Identity >
+    class Pipeline {
+     public:
+      using value_type = typename Stages::template output<typename Source::value_type>;
+
+      Pipeline( Source source_arg, Stages stages_arg = Stages{} )
+      : source( std::move( source_arg ) )
+      , stages( std::move( stages_arg ) )
+      {}
+
+      /// Drive elements into terminal sinks made by make( worker, counter ).
+      ///
+      /// Sinks may count asynchronous work on the counter; drive returns once
+      /// it has drained.
+      ///
+      template < typename Exec, typename Make >
+      void drive( Exec & executor, Make && make )
+      {
+        detail::Counter counter{ 0 };
+        std::vector<decltype( stages.bind( make( size_t( 0 ), counter ) ) )> sinks;
+        sinks.reserve( executor.size() );
+        for( size_t index = 0; index < executor.size(); ++index )
+        {
+          sinks.push_back( stages.bind( make( index, counter ) ) );
+        }
+        source.drive( executor, sinks, counter );
+      }
+
+      /// Run the pipeline for its side effects.
+      ///
+      template < typename Exec >
+      void run( Exec & executor )
+      {
+        for_each( executor, []( const value_type & ){} );
+      }
+
+      /// Call function( element ) on the worker producing each element.
+      ///
+      template < typename Exec, typename Function >
+      void for_each( Exec & executor, Function && function )
+      {
+        drive( executor, [&function]( size_t, detail::Counter & ){ return detail::ForEachSink<Function>{ function }; } );
+      }
+
+      /// Gather every element, grouped by the worker that produced it.
+      ///
+      template < typename Exec >
+      std::vector<typename detail::Stored<value_type>::type> collect( Exec & executor )
+      {
+        using Stored = typename detail::Stored<value_type>::type;
+        std::vector<std::vector<Stored>> parts( executor.size() );
+        for_each( executor, [&parts]( const value_type & value ){ parts[ Exec::current() ].push_back( value ); } );
+
+        std::vector<Stored> result;
+        for( auto & part : parts )
+        {
+          result.insert( result.end(), std::make_move_iterator( part.begin() ), std::make_move_iterator( part.end() ) );
+        }
+        return result;
+      }
+
+      /// Append a stage, or close the fused stages at a group_by().
+      ///
+      template < typename Stage >
+      friend auto operator | ( Pipeline pipeline, Stage stage )
+      {
+        return pipeline.append( std::move( stage ) );
+      }
+
+     protected:
+      template < typename Stage >
+      Pipeline<Source,detail::Compose<Stages,Stage>> append( Stage stage )
+      {
+        return { std::move( source ), detail::Compose<Stages,Stage>{ std::move( stages ), std::move( stage ) } };
+      }
+
+      template < typename KeyFunction, typename Accumulator, typename Reducer, typename Hash >
+      auto append( detail::GroupBy<KeyFunction,Accumulator,Reducer,Hash> stage );
+
+      Source source;
+      Stages stages;
+    };
+
+    namespace detail {
+
+      /// Repartitioning boundary: the upstream pipeline's elements are routed
+      /// to the worker owning hash( key ) and reduced into per-key accumulators.
+      ///
+      /// As a source, each worker then emits its own ( key, accumulator )
+      /// pairs, so downstream stages run where the groups live.
+      ///
+      template < typename Upstream, typename Key, typename Accumulator, typename KeyFunction, typename Reducer, typename Hash >
+      class Grouped {
+       public:
+        using Element = typename Upstream::value_type;
+        using Map = std::unordered_map<Key,Accumulator,Hash>;
+        using value_type = typename Map::value_type;
+
+        Grouped( Upstream upstream_arg, KeyFunction key_arg, Accumulator initial_arg, Reducer reducer_arg, size_t batch_arg )
+        : upstream( std::move( upstream_arg ) )
+        , key( std::move( key_arg ) )
+        , initial( std::move( initial_arg ) )
+        , reducer( std::move( reducer_arg ) )
+        , batch( batch_arg )
+        {}
+
+        template < typename Exec, typename Sinks >
+        void drive( Exec & executor, Sinks & sinks, Counter & counter )
+        {
+          maps = std::make_unique<Map[]>( executor.size() );
+          upstream.drive( executor, [this,&executor]( size_t, Counter & shuffled ){ return Sink<Exec>{ *this, shuffled, executor.size() }; } );
+          executor.each( counter, [this,&sinks]( size_t index )
+            {
+              auto & sink = sinks[ index ];
+              for( auto & entry : maps[ index ] )
+              {
+                sink( entry );
+              }
+              sink.finish();
+            });
+        }
+
+       protected:
+        using Pair = std::pair<Key,Element>;
+
+        void reduce( Map & map, const Key & group, const Element & element )
+        {
+          auto found = map.find( group );
+          if( found == map.end() )
+          {
+            found = map.emplace( group, initial ).first;
+          }
+          reducer( found->second, element );
+        }
+
+        /// Routes elements from one worker, reducing local keys in place.
+        ///
+        template < typename Exec >
+        struct Sink {
+          Grouped & grouped;
+          Counter & counter;
+          std::vector<std::vector<Pair>> outbox;
+
+          Sink( Grouped & grouped_arg, Counter & counter_arg, size_t workers )
+          : grouped( grouped_arg )
+          , counter( counter_arg )
+          , outbox( workers )
+          {}
+
+          template < typename T >
+          void operator()( T && value )
+          {
+            auto group = grouped.key( value );
+            const auto owner = Hash{}( group ) % outbox.size();
+            if( owner == Exec::current() )
+            {
+              grouped.reduce( grouped.maps[ owner ], group, value );
+              return;
+            }
+            outbox[ owner ].emplace_back( std::move( group ), std::forward<T>( value ) );
+            if( outbox[ owner ].size() >= grouped.batch )
+            {
+              flush( owner );
+            }
+          }
+
+          void finish()
+          {
+            for( size_t owner = 0; owner < outbox.size(); ++owner )
+            {
+              if( !outbox[ owner ].empty() )
+              {
+                flush( owner );
+              }
+            }
+          }
+
+          void flush( size_t owner )
+          {
+            counter.increment();
+            Exec::async( owner, [&grouped = grouped,&counter = counter,pairs = std::move( outbox[ owner ] )]
+              {
+                auto & map = grouped.maps[ Exec::current() ];
+                for( auto & pair : pairs )
+                {
+                  grouped.reduce( map, pair.first, pair.second );
+                }
+                counter.decrement();
+              });
+            outbox[ owner ] = std::vector<Pair>{};
+          }
+        };
+
+        Upstream upstream;
+        KeyFunction key;
+        Accumulator initial;
+        Reducer reducer;
+        size_t batch;
+        std::unique_ptr<Map[]> maps;
+      };
+    }
+
+    /// Start a pipeline over items, split across workers in pieces of at
+    /// least grain items as workers go idle.
+    ///
+    template < typename T >
+    Pipeline<detail::Parallel<T>> parallel( std::vector<T> items, size_t grain = 1 )
+    {
+      return { detail::Parallel<T>{ std::move( items ), grain } };
+    }
+
+    /// Replace each element with function( element ).
+    ///
+    template < typename Function >
+    detail::Transform<Function> transform( Function function )
+    {
+      return { std::move( function ) };
+    }
+
+    /// Keep elements for which predicate( element ) is true.
+    ///
+    template < typename Predicate >
+    detail::Filter<Predicate> filter( Predicate predicate )
+    {
+      return { std::move( predicate ) };
+    }
+
+    /// Replace each element with zero or more elements of type Out.
+    ///
+    /// Calls function( element, emit ), which calls emit( out ) per output.
+    ///
+    template < typename Out, typename Function >
+    detail::FlatMap<Out,Function> flat_map( Function function )
+    {
+      return { std::move( function ) };
+    }
+
+    /// Group elements by key( element ), folding each group with
+    /// reducer( accumulator &, element ) from a copy of initial.
+    ///
+    /// @param batch elements buffered per destination worker before sending.
+    ///
+    template < typename KeyFunction, typename Accumulator, typename Reducer, typename Hash = void >
+    detail::GroupBy<KeyFunction,Accumulator,Reducer,Hash> group_by( KeyFunction key, Accumulator initial, Reducer reducer, size_t batch = 1024 )
+    {
+      return { std::move( key ), std::move( initial ), std::move( reducer ), batch };
+    }
+
+    template < typename Source, typename Stages >
+    template < typename KeyFunction, typename Accumulator, typename Reducer, typename Hash >
+    auto Pipeline<Source,Stages>::append( detail::GroupBy<KeyFunction,Accumulator,Reducer,Hash> stage )
+    {
+      using Key = typename std::decay<typename std::result_of<KeyFunction &( const value_type & )>::type>::type;
+      using Grouped = detail::Grouped<Pipeline, Key, Accumulator, KeyFunction, Reducer,
+        typename std::conditional<std::is_void<Hash>::value, std::hash<Key>, Hash>::type>;
+      return Pipeline<Grouped>{ Grouped{ std::move( *this ), std::move( stage.key ), std::move( stage.initial ), std::move( stage.reducer ), stage.batch } };
+    }
+  }
+}
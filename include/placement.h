@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace rabid {
+
+  /// Worker-to-core placement driven by measured traffic.
+  ///
+  /// Capture the traffic matrix of a representative run, compute a placement
+  /// that keeps heavy communicators on cores sharing caches, then pin the
+  /// workers live or apply it to the next executor.
+  ///
+  namespace placement {
+
+    /// Messages sent per ( source, destination ) worker pair.
+    ///
+    using Matrix = std::vector<std::vector<size_t>>;
+
+    /// A cpu and the cache and package domains it belongs to.
+    ///
+    /// Domains are identified by their lowest cpu, so cores with equal ids
+    /// share that domain.
+    ///
+    struct Core {
+      size_t cpu;
+      size_t package;
+      size_t l3;
+      size_t l2;
+    };
+
+    /// Collect the traffic matrix from an executor's worker statistics.
+    ///
+    template < typename Exec >
+    Matrix traffic( const Exec & executor )
+    {
+      Matrix result( executor.size(), std::vector<size_t>( executor.size(), 0 ) );
+      for( size_t source = 0; source < executor.size(); ++source )
+      {
+        for( size_t destination = 0; destination < executor.size(); ++destination )
+        {
+          result[ source ][ destination ] = executor.stats( source ).messages( destination );
+        }
+      }
+      return result;
+    }
+
+    namespace detail {
+
+      /// List the cpus the calling thread may run on.
+      ///
+      /// Falls back to [0,hardware_concurrency()) if the set cannot be read.
+      ///
+      inline std::vector<size_t> allowed()
+      {
+        std::vector<size_t> result;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO( &set );
+        if( 0 == sched_getaffinity( 0, sizeof( set ), &set ) )
+        {
+          for( size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+          {
+            if( CPU_ISSET( cpu, &set ) )
+            {
+              result.push_back( cpu );
+            }
+          }
+        }
+#endif
+        if( result.empty() )
+        {
+          const size_t count = std::max( std::thread::hardware_concurrency(), 1u );
+          for( size_t cpu = 0; cpu < count; ++cpu )
+          {
+            result.push_back( cpu );
+          }
+        }
+        return result;
+      }
+
+      /// Read the first number in a sysfs file, i.e. the lowest cpu of a list.
+      ///
+      inline bool first( const std::string & path, size_t & value )
+      {
+        std::ifstream stream{ path };
+        return bool( stream >> value );
+      }
+
+      /// Find the lowest cpu sharing the given cache level with cpu.
+      ///
+      inline size_t cache( size_t cpu, size_t level )
+      {
+        const auto base = "/sys/devices/system/cpu/cpu" + std::to_string( cpu ) + "/cache/index";
+        for( size_t index = 0; index < 8; ++index )
+        {
+          size_t found = 0;
+          size_t shared = 0;
+          if( first( base + std::to_string( index ) + "/level", found ) && found == level
+            && first( base + std::to_string( index ) + "/shared_cpu_list", shared ) )
+          {
+            return shared;
+          }
+        }
+        return cpu;
+      }
+    }
+
+    /// Read the cpu topology from sysfs.
+    ///
+    /// Only cpus in the calling thread's affinity set are listed, so offline
+    /// or excluded cpus are never placed. Cpus whose topology cannot be read
+    /// are treated as a package of their own, so placement degrades to the
+    /// identity rather than failing.
+    ///
+    inline std::vector<Core> topology()
+    {
+      std::vector<Core> cores;
+      for( auto cpu : detail::allowed() )
+      {
+        size_t package = cpu;
+        detail::first( "/sys/devices/system/cpu/cpu" + std::to_string( cpu ) + "/topology/physical_package_id", package );
+        cores.push_back( Core{ cpu, package, detail::cache( cpu, 3 ), detail::cache( cpu, 2 ) } );
+      }
+      return cores;
+    }
+
+    /// Place worker i on cores[ i ], wrapping if there are more workers.
+    ///
+    inline std::vector<size_t> linear( size_t workers, const std::vector<Core> & cores )
+    {
+      std::vector<size_t> result( workers );
+      for( size_t index = 0; index < workers; ++index )
+      {
+        result[ index ] = index % cores.size();
+      }
+      return result;
+    }
+
+    /// Compute a placement keeping heavy communicators on nearby cores.
+    ///
+    /// Cores are filled in ( package, l3, l2 ) order. Each is given the
+    /// unplaced worker exchanging the most messages with workers already
+    /// placed, weighted by how much of the hierarchy their cores share; ties
+    /// go to the busiest worker.
+    ///
+    /// @return index into cores for each worker.
+    ///
+    inline std::vector<size_t> optimize( const Matrix & traffic, const std::vector<Core> & cores )
+    {
+      const auto workers = traffic.size();
+      std::vector<size_t> order( cores.size() );
+      for( size_t index = 0; index < order.size(); ++index )
+      {
+        order[ index ] = index;
+      }
+      std::stable_sort( order.begin(), order.end(), [&cores]( size_t a, size_t b )
+        {
+          return std::tie( cores[ a ].package, cores[ a ].l3, cores[ a ].l2 ) < std::tie( cores[ b ].package, cores[ b ].l3, cores[ b ].l2 );
+        });
+
+      const auto weight = [&traffic]( size_t a, size_t b ){ return traffic[ a ][ b ] + traffic[ b ][ a ]; };
+      const auto share = [&cores]( size_t a, size_t b ) -> size_t
+      {
+        return cores[ a ].l2 == cores[ b ].l2 ? 4 : cores[ a ].l3 == cores[ b ].l3 ? 2 : cores[ a ].package == cores[ b ].package ? 1 : 0;
+      };
+
+      std::vector<size_t> busy( workers, 0 );
+      for( size_t a = 0; a < workers; ++a )
+      {
+        for( size_t b = 0; b < workers; ++b )
+        {
+          busy[ a ] += weight( a, b );
+        }
+      }
+
+      std::vector<size_t> result( workers, cores.size() );
+      std::vector<size_t> placed;
+      for( size_t slot = 0; slot < workers; ++slot )
+      {
+        const auto core = order[ slot % order.size() ];
+        size_t best = workers;
+        size_t best_score = 0;
+        for( size_t candidate = 0; candidate < workers; ++candidate )
+        {
+          if( result[ candidate ] != cores.size() )
+          {
+            continue;
+          }
+          size_t score = 0;
+          for( auto other : placed )
+          {
+            score += weight( candidate, other ) * share( core, result[ other ] );
+          }
+          if( best == workers || score > best_score || ( score == best_score && busy[ candidate ] > busy[ best ] ) )
+          {
+            best = candidate;
+            best_score = score;
+          }
+        }
+        result[ best ] = core;
+        placed.push_back( best );
+      }
+      return result;
+    }
+
+    /// Query the fraction of messages crossing packages under a placement.
+    ///
+    inline double cross_socket( const Matrix & traffic, const std::vector<Core> & cores, const std::vector<size_t> & placement )
+    {
+      size_t total = 0;
+      size_t crossing = 0;
+      for( size_t source = 0; source < traffic.size(); ++source )
+      {
+        for( size_t destination = 0; destination < traffic.size(); ++destination )
+        {
+          total += traffic[ source ][ destination ];
+          if( cores[ placement[ source ] ].package != cores[ placement[ destination ] ].package )
+          {
+            crossing += traffic[ source ][ destination ];
+          }
+        }
+      }
+      return total ? double( crossing ) / double( total ) : 0.0;
+    }
+
+    /// Pin each worker to its placed core.
+    ///
+    /// @return false if any worker could not be pinned.
+    ///
+    template < typename Exec >
+    bool apply( Exec & executor, const std::vector<Core> & cores, const std::vector<size_t> & placement )
+    {
+      bool pinned = true;
+      for( size_t index = 0; index < placement.size(); ++index )
+      {
+        pinned = executor.pin( index, cores[ placement[ index ] ].cpu ) && pinned;
+      }
+      return pinned;
+    }
+  }
+}
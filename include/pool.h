@@ -0,0 +1,204 @@
+#pragma once
+
+#include "Executor.h"
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rabid {
+
+  /// Per-worker object pool for an Executor.
+  ///
+  /// Each worker allocates objects from its own blocks and recycles them
+  /// through its own free list. An object released on another worker is
+  /// queued there and sent home in batches over the interconnect, so objects
+  /// keep returning to the worker whose cache they are warm in, and no free
+  /// list is ever shared.
+  ///
+  /// Objects are constructed on first acquire. With the default Reset = void,
+  /// release destroys the object and acquire constructs a new one in its slot.
+  /// Otherwise release calls Reset{}( object ) and keeps it constructed, and
+  /// acquire hands back the reset object without constructing it again.
+  ///
+  /// acquire(), release() and flush() must be called from a worker. The pool
+  /// must outlive every object, and be destroyed once the executor is idle.
+  ///
+  template < typename Exec, typename T, typename Reset = void >
+  class Pool {
+   protected:
+    struct Slot;
+
+   public:
+    /// Releases an object back to its pool.
+    ///
+    struct Releaser {
+      Pool * pool;
+      void operator()( T * object ) const { pool->release( object ); }
+    };
+
+    using Pointer = std::unique_ptr<T,Releaser>;
+
+    /// @param workers number of workers in the executor.
+    /// @param batch objects queued for another worker before sending them.
+    /// @param block objects allocated together when a free list is empty.
+    ///
+    Pool( size_t workers, size_t batch_arg = 64, size_t block_arg = 64 )
+    : batch( std::max( batch_arg, size_t( 1 ) ) )
+    , block( std::max( block_arg, size_t( 1 ) ) )
+    , locals( std::make_unique<Local[]>( workers ) )
+    , count( workers )
+    {
+      for( size_t index = 0; index < count; ++index )
+      {
+        locals[ index ].outbox.resize( count );
+      }
+    }
+
+    ~Pool()
+    {
+      for( size_t index = 0; index < count; ++index )
+      {
+        for( auto & storage : locals[ index ].blocks )
+        {
+          for( size_t offset = 0; offset < block; ++offset )
+          {
+            storage[ offset ].destroy();
+          }
+        }
+      }
+    }
+
+    Pool( const Pool & ) = delete;
+    Pool & operator = ( const Pool & ) = delete;
+
+    /// Take an object from the current worker's free list.
+    ///
+    /// If the slot holds no object, one is constructed from args; a reset
+    /// object is returned as is.
+    ///
+    template < typename ...Args >
+    Pointer acquire( Args && ...args )
+    {
+      auto & local = locals[ Exec::current() ];
+      if( local.free.empty() )
+      {
+        grow( local, Exec::current() );
+      }
+      auto slot = local.free.back();
+      local.free.pop_back();
+      if( !slot->constructed )
+      {
+        new ( &slot->storage ) T( std::forward<Args>( args )... );
+        slot->constructed = true;
+      }
+      return Pointer{ slot->object(), Releaser{ this } };
+    }
+
+    /// Return an object to the pool.
+    ///
+    /// Objects from the current worker are recycled immediately; others are
+    /// queued and sent home once batch of them are waiting.
+    ///
+    void release( T * object )
+    {
+      auto slot = reinterpret_cast<Slot *>( object );
+      recycle( slot );
+
+      const auto current = Exec::current();
+      auto & local = locals[ current ];
+      if( slot->home == current )
+      {
+        local.free.push_back( slot );
+        return;
+      }
+      auto & queue = local.outbox[ slot->home ];
+      queue.push_back( slot );
+      if( queue.size() >= batch )
+      {
+        send( local, slot->home );
+      }
+    }
+
+    /// Send every queued object home, regardless of batch size.
+    ///
+    void flush()
+    {
+      auto & local = locals[ Exec::current() ];
+      for( size_t home = 0; home < count; ++home )
+      {
+        if( !local.outbox[ home ].empty() )
+        {
+          send( local, home );
+        }
+      }
+    }
+
+    /// Query objects allocated by a worker. Must be called on that worker.
+    ///
+    size_t capacity( size_t worker ) const { return locals[ worker ].blocks.size() * block; }
+
+    /// Query objects in a worker's free list. Must be called on that worker.
+    ///
+    size_t available( size_t worker ) const { return locals[ worker ].free.size(); }
+
+   protected:
+    struct Slot {
+      typename std::aligned_storage<sizeof( T ), alignof( T )>::type storage;
+      size_t home;
+      bool constructed = false;
+
+      T * object() { return reinterpret_cast<T *>( &storage ); }
+
+      void destroy()
+      {
+        if( constructed )
+        {
+          object()->~T();
+          constructed = false;
+        }
+      }
+    };
+
+    struct alignas(64) Local {
+      std::vector<Slot *> free;
+      std::vector<std::vector<Slot *>> outbox;
+      std::vector<std::unique_ptr<Slot[]>> blocks;
+    };
+
+    template < typename R = Reset >
+    typename std::enable_if<std::is_void<R>::value>::type recycle( Slot * slot ) { slot->destroy(); }
+
+    template < typename R = Reset >
+    typename std::enable_if<!std::is_void<R>::value>::type recycle( Slot * slot ) { R{}( *slot->object() ); }
+
+    void grow( Local & local, size_t home )
+    {
+      local.blocks.push_back( std::make_unique<Slot[]>( block ) );
+      auto storage = local.blocks.back().get();
+      for( size_t offset = block; offset > 0; --offset )
+      {
+        storage[ offset - 1 ].home = home;
+        local.free.push_back( &storage[ offset - 1 ] );
+      }
+    }
+
+    void send( Local & local, size_t home )
+    {
+      Exec::async( home, [this,slots = std::move( local.outbox[ home ] )]
+        {
+          auto & free = locals[ Exec::current() ].free;
+          free.insert( free.end(), slots.begin(), slots.end() );
+        });
+      local.outbox[ home ] = std::vector<Slot *>{};
+      local.outbox[ home ].reserve( batch );
+    }
+
+    const size_t batch;
+    const size_t block;
+    std::unique_ptr<Local[]> locals;
+    const size_t count;
+  };
+}
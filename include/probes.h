@@ -0,0 +1,56 @@
+#pragma once
+
+/// Optional USDT tracepoints for perf and bpftrace.
+///
+/// With RABID_USDT defined and <sys/sdt.h> available (systemtap's headers),
+/// RABID_PROBEn( name, args... ) places a static probe rabid:name. An
+/// unattached probe is a single nop; its arguments are only materialized in
+/// registers. RABID_PROBES_ENABLED is then defined as well. Otherwise the
+/// macros expand to nothing, and probe arguments must not have side effects
+/// the program depends on.
+///
+/// Probes:
+///
+///   - rabid:sweep_begin( worker ), rabid:sweep_end( worker, processed ):
+///     one pass over a worker's connections.
+///   - rabid:yield( worker ), rabid:wake( worker ): a worker parking idle and
+///     resuming.
+///   - rabid:task_begin( worker, task ), rabid:task_end( worker, task ):
+///     evaluation of a received task.
+///   - rabid:send( worker, destination ): a task sent through the worker's
+///     interconnect node.
+///   - rabid:continuation( result, continuation ): a completed result
+///     dispatching one dependant continuation.
+///
+/// For example: bpftrace -e 'usdt:./comparison:rabid:send { @[arg0, arg1] = count(); }'
+///
+#if defined( RABID_USDT ) && defined( __has_include )
+#if __has_include( <sys/sdt.h> )
+#include <sys/sdt.h>
+#define RABID_PROBES_ENABLED 1
+#define RABID_PROBE1( name, a ) DTRACE_PROBE1( rabid, name, a )
+#define RABID_PROBE2( name, a, b ) DTRACE_PROBE2( rabid, name, a, b )
+#endif
+#endif
+
+#ifndef RABID_PROBE1
+#define RABID_PROBE1( name, a ) do {} while( 0 )
+#define RABID_PROBE2( name, a, b ) do {} while( 0 )
+#endif
+
+namespace rabid {
+
+  namespace probes {
+
+    /// Query if USDT probes are compiled in.
+    ///
+    constexpr bool enabled()
+    {
+#ifdef RABID_PROBES_ENABLED
+      return true;
+#else
+      return false;
+#endif
+    }
+  }
+}
@@ -0,0 +1,499 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace rabid {
+
+  /// Fixed-size, mergeable stream summaries.
+  ///
+  /// Each worker feeds its own sketch without synchronization. Sketches of the
+  /// same shape merge associatively, so per-worker results combine with a
+  /// Reduction instead of shuffling keys between workers.
+  ///
+  namespace sketch {
+
+    /// Finalize a hash so every bit depends on every input bit.
+    ///
+    /// std::hash is often the identity or a weak fold, which leaves high bits
+    /// empty. Sketches index by high bits, so all keys pass through here.
+    ///
+    inline std::uint64_t mix( std::uint64_t value )
+    {
+      value ^= value >> 33;
+      value *= 0xff51afd7ed558ccdull;
+      value ^= value >> 33;
+      value *= 0xc4ceb9fe1a85ec53ull;
+      value ^= value >> 33;
+      return value;
+    }
+
+    /// Count-Min sketch of key frequencies.
+    ///
+    /// Estimates never undercount, and overcount by at most total / width *
+    /// e with probability 1 - e^-depth. Rows are indexed by double hashing of
+    /// a single key hash.
+    ///
+    template < typename Key, typename Hash = std::hash<Key> >
+    class CountMin {
+     public:
+      /// @param width counters per row, rounded up to a power of two.
+      /// @param depth number of rows.
+      ///
+      CountMin( size_t width = 1024, size_t depth = 4 )
+      : mask( round( width ) - 1 )
+      , rows( depth )
+      , counters( ( mask + 1 ) * depth, 0 )
+      {}
+
+      /// Count a key.
+      ///
+      /// @return the updated estimate for key.
+      ///
+      std::uint64_t insert( const Key & key, std::uint64_t count = 1 )
+      {
+        std::uint64_t result = ~std::uint64_t( 0 );
+        visit( key, [this,&result,count]( size_t slot )
+          {
+            counters[ slot ] += count;
+            result = std::min( result, counters[ slot ] );
+          });
+        total += count;
+        return result;
+      }
+
+      /// Estimate the count of a key.
+      ///
+      std::uint64_t estimate( const Key & key ) const
+      {
+        std::uint64_t result = ~std::uint64_t( 0 );
+        visit( key, [this,&result]( size_t slot )
+          {
+            result = std::min( result, counters[ slot ] );
+          });
+        return result;
+      }
+
+      /// Add another sketch's counts. Both must have the same width and depth.
+      ///
+      void merge( const CountMin & other )
+      {
+        for( size_t index = 0; index < counters.size(); ++index )
+        {
+          counters[ index ] += other.counters[ index ];
+        }
+        total += other.total;
+      }
+
+      size_t width() const { return mask + 1; }
+      size_t depth() const { return rows; }
+
+      /// Query the total of all counts inserted.
+      ///
+      std::uint64_t size() const { return total; }
+
+     protected:
+      static size_t round( size_t width )
+      {
+        size_t result = 1;
+        while( result < width )
+        {
+          result <<= 1;
+        }
+        return result;
+      }
+
+      /// Call function( slot ) with the counter index of key in each row.
+      ///
+      template < typename Function >
+      void visit( const Key & key, Function && function ) const
+      {
+        const auto hash = mix( Hash{}( key ) );
+        const auto step = mix( hash ) | 1;
+        for( size_t row = 0; row < rows; ++row )
+        {
+          function( row * ( mask + 1 ) + size_t( ( hash + row * step ) & mask ) );
+        }
+      }
+
+      size_t mask;
+      size_t rows;
+      std::vector<std::uint64_t> counters;
+      std::uint64_t total = 0;
+    };
+
+    /// Count-Min sketch tracking the k keys with the highest estimates.
+    ///
+    /// Candidates live in a min-heap keyed by the estimate recorded when they
+    /// were pushed. Estimates only grow, so a stale root is refreshed and
+    /// re-sifted before it is compared against a newcomer.
+    ///
+    template < typename Key, typename Hash = std::hash<Key> >
+    class HeavyHitters {
+     public:
+      HeavyHitters( size_t k_arg = 16, size_t width = 1024, size_t depth = 4 )
+      : k( k_arg )
+      , counts( width, depth )
+      {}
+
+      void insert( const Key & key, std::uint64_t count = 1 )
+      {
+        offer( key, counts.insert( key, count ) );
+      }
+
+      /// Merge another sketch, re-ranking the union of both candidate sets.
+      ///
+      void merge( const HeavyHitters & other )
+      {
+        counts.merge( other.counts );
+        auto keys = std::move( candidates );
+        for( auto & entry : other.candidates )
+        {
+          keys.emplace( entry.first, 0 );
+        }
+        candidates.clear();
+        heap.clear();
+        for( auto & entry : keys )
+        {
+          offer( entry.first, counts.estimate( entry.first ) );
+        }
+      }
+
+      /// Query the candidates ordered by descending estimate.
+      ///
+      std::vector<std::pair<Key,std::uint64_t>> top() const
+      {
+        std::vector<std::pair<Key,std::uint64_t>> result{ candidates.begin(), candidates.end() };
+        std::sort( result.begin(), result.end(), []( const std::pair<Key,std::uint64_t> & a, const std::pair<Key,std::uint64_t> & b )
+          {
+            return a.second > b.second;
+          });
+        return result;
+      }
+
+      const CountMin<Key,Hash> & sketch() const { return counts; }
+
+     protected:
+      using Entry = std::pair<std::uint64_t,Key>;
+
+      static bool later( const Entry & a, const Entry & b ) { return a.first > b.first; }
+
+      void offer( const Key & key, std::uint64_t estimate )
+      {
+        auto found = candidates.find( key );
+        if( found != candidates.end() )
+        {
+          found->second = estimate;
+          return;
+        }
+        if( candidates.size() < k )
+        {
+          candidates.emplace( key, estimate );
+          heap.emplace_back( estimate, key );
+          std::push_heap( heap.begin(), heap.end(), later );
+          return;
+        }
+        while( k && estimate > heap.front().first )
+        {
+          std::pop_heap( heap.begin(), heap.end(), later );
+          auto & root = heap.back();
+          const auto current = candidates[ root.second ];
+          if( current == root.first )
+          {
+            candidates.erase( root.second );
+            candidates.emplace( key, estimate );
+            root = Entry{ estimate, key };
+            std::push_heap( heap.begin(), heap.end(), later );
+            return;
+          }
+          root.first = current;
+          std::push_heap( heap.begin(), heap.end(), later );
+        }
+      }
+
+      size_t k;
+      CountMin<Key,Hash> counts;
+      std::unordered_map<Key,std::uint64_t,Hash> candidates;
+      std::vector<Entry> heap;
+    };
+
+    /// Space-Saving top-k summary.
+    ///
+    /// Holds exactly k counters. An unmonitored key replaces the minimum
+    /// counter and inherits its count as error, so count - error <= true
+    /// count <= count. Counters form an indexed min-heap for O(log k) updates.
+    ///
+    template < typename Key, typename Hash = std::hash<Key> >
+    class SpaceSaving {
+     public:
+      struct Counter {
+        Key key;
+        std::uint64_t count;
+        std::uint64_t error;
+      };
+
+      SpaceSaving( size_t k_arg = 16 )
+      : k( k_arg )
+      {}
+
+      void insert( const Key & key, std::uint64_t count = 1 )
+      {
+        auto found = index.find( key );
+        if( found != index.end() )
+        {
+          heap[ found->second ].count += count;
+          sift_down( found->second );
+        }
+        else if( heap.size() < k )
+        {
+          index.emplace( key, heap.size() );
+          heap.push_back( Counter{ key, count, 0 } );
+          sift_up( heap.size() - 1 );
+        }
+        else if( k )
+        {
+          auto & root = heap.front();
+          index.erase( root.key );
+          index.emplace( key, 0 );
+          root = Counter{ key, root.count + count, root.count };
+          sift_down( 0 );
+        }
+      }
+
+      /// Merge another summary of the same capacity.
+      ///
+      /// A key missing from a full summary may have been counted up to that
+      /// summary's minimum, which is added to both its count and error.
+      ///
+      void merge( const SpaceSaving & other )
+      {
+        const auto floor = minimum();
+        const auto other_floor = other.minimum();
+
+        std::unordered_map<Key,Counter,Hash> merged;
+        for( auto & counter : heap )
+        {
+          merged.emplace( counter.key, Counter{ counter.key, counter.count + other_floor, counter.error + other_floor } );
+        }
+        for( auto & counter : other.heap )
+        {
+          auto result = merged.emplace( counter.key, Counter{ counter.key, counter.count + floor, counter.error + floor } );
+          if( !result.second )
+          {
+            result.first->second.count += counter.count - other_floor;
+            result.first->second.error += counter.error - other_floor;
+          }
+        }
+
+        heap.clear();
+        index.clear();
+        for( auto & entry : merged )
+        {
+          heap.push_back( entry.second );
+        }
+        std::sort( heap.begin(), heap.end(), []( const Counter & a, const Counter & b ){ return a.count > b.count; } );
+        heap.resize( std::min( heap.size(), k ) );
+        std::reverse( heap.begin(), heap.end() );
+        for( size_t position = 0; position < heap.size(); ++position )
+        {
+          index.emplace( heap[ position ].key, position );
+        }
+      }
+
+      /// Query counters ordered by descending count.
+      ///
+      std::vector<Counter> top() const
+      {
+        auto result = heap;
+        std::sort( result.begin(), result.end(), []( const Counter & a, const Counter & b ){ return a.count > b.count; } );
+        return result;
+      }
+
+      /// Query the smallest count, which bounds any unmonitored key.
+      ///
+      std::uint64_t minimum() const { return heap.size() < k || heap.empty() ? 0 : heap.front().count; }
+
+     protected:
+      void swap( size_t a, size_t b )
+      {
+        std::swap( heap[ a ], heap[ b ] );
+        index[ heap[ a ].key ] = a;
+        index[ heap[ b ].key ] = b;
+      }
+
+      void sift_up( size_t position )
+      {
+        while( position && heap[ position ].count < heap[ ( position - 1 ) / 2 ].count )
+        {
+          swap( position, ( position - 1 ) / 2 );
+          position = ( position - 1 ) / 2;
+        }
+      }
+
+      void sift_down( size_t position )
+      {
+        for(;;)
+        {
+          auto smallest = position;
+          for( auto child = 2 * position + 1; child < 2 * position + 3 && child < heap.size(); ++child )
+          {
+            if( heap[ child ].count < heap[ smallest ].count )
+            {
+              smallest = child;
+            }
+          }
+          if( smallest == position )
+          {
+            return;
+          }
+          swap( position, smallest );
+          position = smallest;
+        }
+      }
+
+      size_t k;
+      std::vector<Counter> heap;
+      std::unordered_map<Key,size_t,Hash> index;
+    };
+
+    /// HyperLogLog cardinality estimator.
+    ///
+    /// Uses 2^precision one-byte registers, for a standard error of about
+    /// 1.04 / sqrt(2^precision). Merging takes the register-wise maximum,
+    /// sixteen registers at a time where SSE2 is available.
+    ///
+    template < typename Key, typename Hash = std::hash<Key> >
+    class HyperLogLog {
+     public:
+      /// @param precision register index bits, in [4, 18].
+      ///
+      HyperLogLog( unsigned precision_arg = 12 )
+      : precision( std::min( std::max( precision_arg, 4u ), 18u ) )
+      , registers( size_t( 1 ) << precision, 0 )
+      {}
+
+      void insert( const Key & key )
+      {
+        const auto hash = mix( Hash{}( key ) );
+        const auto index = size_t( hash >> ( 64 - precision ) );
+        const auto rest = ( hash << precision ) | ( std::uint64_t( 1 ) << ( precision - 1 ) );
+        const auto rank = std::uint8_t( __builtin_clzll( rest ) + 1 );
+        registers[ index ] = std::max( registers[ index ], rank );
+      }
+
+      /// Merge another estimator of the same precision.
+      ///
+      void merge( const HyperLogLog & other )
+      {
+        size_t index = 0;
+#ifdef __SSE2__
+        for( ; index + 16 <= registers.size(); index += 16 )
+        {
+          const auto a = _mm_loadu_si128( reinterpret_cast<const __m128i *>( registers.data() + index ) );
+          const auto b = _mm_loadu_si128( reinterpret_cast<const __m128i *>( other.registers.data() + index ) );
+          _mm_storeu_si128( reinterpret_cast<__m128i *>( registers.data() + index ), _mm_max_epu8( a, b ) );
+        }
+#endif
+        for( ; index < registers.size(); ++index )
+        {
+          registers[ index ] = std::max( registers[ index ], other.registers[ index ] );
+        }
+      }
+
+      /// Estimate the number of distinct keys inserted.
+      ///
+      double estimate() const
+      {
+        const auto m = double( registers.size() );
+        double sum = 0.0;
+        size_t zeros = 0;
+        for( auto rank : registers )
+        {
+          sum += std::ldexp( 1.0, -int( rank ) );
+          zeros += ( rank == 0 );
+        }
+
+        const auto alpha = 0.7213 / ( 1.0 + 1.079 / m );
+        const auto raw = alpha * m * m / sum;
+        if( raw <= 2.5 * m && zeros )
+        {
+          return m * std::log( m / double( zeros ) );
+        }
+        return raw;
+      }
+
+     protected:
+      unsigned precision;
+      std::vector<std::uint8_t> registers;
+    };
+
+    /// Combines one sketch per worker with a binomial tree over an Executor.
+    ///
+    /// Worker i merges its children i + 2^j (for 2^j below i's lowest set
+    /// bit) and then sends itself to its parent, i with the lowest set bit
+    /// cleared. Each worker calls arrive() once its local input is done; the
+    /// root invokes the completion with the combined sketch. Merges run on the
+    /// receiving worker, so no sketch is touched by two workers at once and
+    /// only log2(workers) merges lie on the critical path.
+    ///
+    template < typename Exec, typename Sketch >
+    class Reduction {
+     public:
+      using Done = std::function<void( Sketch & )>;
+
+      Reduction( Sketch * sketches_arg, size_t workers, Done done_arg )
+      : sketches( sketches_arg )
+      , pending( std::make_unique<size_t[]>( workers ) )
+      , done( std::move( done_arg ) )
+      {
+        for( size_t index = 0; index < workers; ++index )
+        {
+          pending[ index ] = 1;
+          const auto lowest = ( index ? index & ( ~index + 1 ) : workers );
+          for( size_t stride = 1; stride < lowest && index + stride < workers; stride <<= 1 )
+          {
+            pending[ index ] += 1;
+          }
+        }
+      }
+
+      /// Signal that the current worker's sketch is complete.
+      ///
+      void arrive() { arrive( Exec::current() ); }
+
+     protected:
+      void arrive( size_t index )
+      {
+        if( --pending[ index ] )
+        {
+          return;
+        }
+        if( index == 0 )
+        {
+          done( sketches[ 0 ] );
+          return;
+        }
+        const auto parent = index & ( index - 1 );
+        Exec::async( parent, [this,index,parent]
+          {
+            sketches[ parent ].merge( sketches[ index ] );
+            arrive( parent );
+          });
+      }
+
+      Sketch * sketches;
+      std::unique_ptr<size_t[]> pending;
+      Done done;
+    };
+  }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "accounting.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace rabid {
+
+  /// Runtime statistics gathered by Executor workers.
+  ///
+  /// Each statistic is written by exactly one worker and may be read by any
+  /// thread. Values are relaxed atomics updated via load/store, so the writer
+  /// never pays for a locked instruction and readers see stale-but-whole
+  /// values.
+  ///
+  namespace stats {
+
+    /// Capture a 32-bit send timestamp in nanoseconds.
+    ///
+    /// Timestamps wrap every ~4.3 seconds, which bounds the measurable delay.
+    /// The low bit is forced so that a valid timestamp is never zero, allowing
+    /// zero to mean "not sampled".
+    ///
+    inline std::uint32_t stamp()
+    {
+      const auto now = std::chrono::steady_clock::now().time_since_epoch();
+      return static_cast<std::uint32_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( now ).count() ) | 1u;
+    }
+
+    /// Nanoseconds elapsed since the given timestamp (modulo 2^32).
+    ///
+    inline std::uint32_t elapsed( std::uint32_t since )
+    {
+      return stamp() - since;
+    }
+
+    /// Log2-bucketed histogram of 32-bit samples.
+    ///
+    /// Bucket 0 counts zero samples, and bucket B counts samples in the range
+    /// [2^(B-1), 2^B).
+    ///
+    class Histogram {
+     public:
+      static constexpr size_t buckets = 33;
+
+      /// Record a sample. Only the owning worker may insert.
+      ///
+      void insert( std::uint32_t sample )
+      {
+        auto & counter = counts[ bucket( sample ) ];
+        counter.store( counter.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+      }
+
+      /// Query the number of samples in the given bucket.
+      ///
+      size_t count( size_t index ) const { return counts[ index ].load( std::memory_order_relaxed ); }
+
+      /// Query the total number of samples.
+      ///
+      size_t total() const
+      {
+        size_t result = 0;
+        for( auto & counter : counts )
+        {
+          result += counter.load( std::memory_order_relaxed );
+        }
+        return result;
+      }
+
+      /// Query an upper bound for the given quantile in [0,1].
+      ///
+      /// @return exclusive upper bound of the bucket holding the quantile.
+      ///
+      std::uint64_t quantile( double fraction ) const
+      {
+        const auto limit = static_cast<size_t>( fraction * double( total() ) );
+        size_t seen = 0;
+        for( size_t index = 0; index < buckets; ++index )
+        {
+          seen += count( index );
+          if( seen > limit )
+          {
+            return upper( index );
+          }
+        }
+        return upper( buckets - 1 );
+      }
+
+      /// Bucket index for a sample.
+      ///
+      static size_t bucket( std::uint32_t sample )
+      {
+        return sample ? size_t( 32 - __builtin_clz( sample ) ) : 0;
+      }
+
+      /// Exclusive upper bound of a bucket.
+      ///
+      static std::uint64_t upper( size_t index ) { return std::uint64_t{1} << index; }
+
+     protected:
+      std::atomic<size_t> counts[ buckets ] = {};
+    };
+
+    /// Statistics for a single worker.
+    ///
+    class Worker {
+     public:
+
+      /// Create statistics for a worker with the given inbound connections.
+      ///
+      /// @param connections Number of inbound connections.
+      /// @param sampled Allocate queueing delay histograms.
+      /// @param workers Number of workers messages may be sent to.
+      ///
+      Worker( size_t connections, bool sampled, size_t workers = 0 )
+      : delays( sampled ? std::make_unique<Histogram[]>( connections ) : nullptr )
+      , traffic( std::make_unique<std::atomic<size_t>[]>( workers ) )
+      , destinations( workers )
+      , charge( accounting::Kind::stats, ( sampled ? connections * sizeof( Histogram ) : 0 ) + workers * sizeof( std::atomic<size_t> ) )
+      {}
+
+      /// Query if queueing delay is sampled.
+      ///
+      bool sampled() const { return delays != nullptr; }
+
+      /// Send to evaluate delay (nanoseconds) of sampled messages.
+      ///
+      /// Only valid if sampled().
+      ///
+      /// @param connection Index of the inbound connection.
+      ///
+      const Histogram & delay( size_t connection ) const { return delays[ connection ]; }
+      Histogram & delay( size_t connection ) { return delays[ connection ]; }
+
+      /// Count a message sent to the given worker. Only the owning worker
+      /// may record.
+      ///
+      void message( size_t destination )
+      {
+        auto & counter = traffic[ destination ];
+        counter.store( counter.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+      }
+
+      /// Query messages this worker sent to the given worker.
+      ///
+      /// Together, the workers' counts form a traffic matrix with one row per
+      /// sending worker.
+      ///
+      size_t messages( size_t destination ) const { return traffic[ destination ].load( std::memory_order_relaxed ); }
+
+      /// Query the number of workers messages are counted for.
+      ///
+      size_t workers() const { return destinations; }
+
+     protected:
+      std::unique_ptr<Histogram[]> delays;
+      std::unique_ptr<std::atomic<size_t>[]> traffic;
+      size_t destinations;
+      accounting::Charge charge;
+    };
+  }
+}
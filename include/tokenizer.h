@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace rabid {
+
+  /// Non-owning view of a whitespace delimited token.
+  ///
+  template < typename CharT, typename Traits = std::char_traits<CharT> >
+  struct Token {
+    const CharT * begin;
+    const CharT * end;
+
+    size_t size() const { return size_t(end - begin); }
+
+    size_t bucket( size_t concurrency ) const { return (size_t(*begin) + size()) % concurrency; }
+
+    friend bool operator == ( const Token & a, const Token & b )
+    {
+      return a.size() == b.size() && Traits::compare( a.begin, b.begin, a.size() ) == 0;
+    }
+
+    friend bool operator < ( const Token & a, const Token & b )
+    {
+      const auto result = Traits::compare( a.begin, b.begin, std::min( a.size(), b.size() ) );
+      return result < 0 || ( result == 0 && a.size() < b.size() );
+    }
+
+    friend std::ostream & operator << ( std::ostream & stream, const Token & token )
+    {
+      if( token.begin != token.end )
+      {
+        stream.write( token.begin, token.end - token.begin );
+      }
+      return stream;
+    }
+  };
+
+  /// Splits a character range into whitespace delimited tokens.
+  ///
+  template < typename CharT, typename Traits = std::char_traits<CharT> >
+  class Tokenizer {
+   public:
+
+    bool empty() const { return begin == end; }
+
+    Token<CharT> next()
+    {
+      Token<CharT> result{};
+
+      result.begin = begin;
+
+      while( begin != end && !std::isspace(Traits::to_int_type(*begin)) )
+      {
+        begin += 1;
+      }
+      result.end = begin;
+
+      while( begin != end && std::isspace(Traits::to_int_type(*begin)) )
+      {
+        begin += 1;
+      }
+
+      return result;
+    }
+
+    Tokenizer( const CharT * array, size_t size )
+    : begin( array )
+    , end( array + size )
+    {
+      while( begin != end && std::isspace(Traits::to_int_type(*begin)) )
+      {
+        begin += 1;
+      }
+    }
+   protected:
+    const CharT * begin;
+    const CharT * const end;
+  };
+
+  namespace detail {
+
+    template < typename T >
+    size_t hash_combine( size_t seed, const T & value )
+    {
+      return (seed << 1) ^ std::hash<T>{}( value );
+    }
+  }
+}
+
+namespace std {
+
+  template < typename CharT >
+  struct hash<rabid::Token<CharT>>
+  {
+    size_t operator() ( const rabid::Token<CharT> & token ) const
+    {
+      size_t seed = 0;
+      for( auto current = token.begin; current != token.end; ++current )
+      {
+        seed = rabid::detail::hash_combine( seed, *current );
+      }
+      return seed;
+    }
+  };
+}
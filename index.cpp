@@ -0,0 +1,520 @@
+
+#include <limits>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+
+#include "include/Executor.h"
+#include "include/mapped_file.h"
+#include "include/placement.h"
+#include "include/tokenizer.h"
+
+using namespace rabid;
+
+using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+using Text = Token<char>;
+
+/// Append an unsigned LEB128 varint.
+///
+inline void put( std::vector<std::uint8_t> & bytes, std::uint32_t value )
+{
+  while( value >= 0x80 )
+  {
+    bytes.push_back( std::uint8_t( value | 0x80 ) );
+    value >>= 7;
+  }
+  bytes.push_back( std::uint8_t( value ) );
+}
+
+/// Consume an unsigned LEB128 varint.
+///
+inline std::uint32_t get( const std::uint8_t *& cursor )
+{
+  std::uint32_t value = 0;
+  for( unsigned shift = 0;; shift += 7 )
+  {
+    const auto byte = *cursor++;
+    value |= std::uint32_t( byte & 0x7f ) << shift;
+    if( !( byte & 0x80 ) )
+    {
+      return value;
+    }
+  }
+}
+
+/// Delta + varint encoding of (document, position) pairs in order.
+///
+/// Each pair is the document gap, then the position: relative to the prior
+/// position within the same document, otherwise absolute.
+///
+class Encoder {
+ public:
+  void operator()( std::vector<std::uint8_t> & bytes, std::uint32_t document_arg, std::uint32_t position_arg )
+  {
+    const auto gap = document_arg - document;
+    put( bytes, gap );
+    put( bytes, gap ? position_arg : position_arg - position );
+    document = document_arg;
+    position = position_arg;
+  }
+
+  /// Decode count pairs, calling function( document, position ) for each.
+  ///
+  template < typename Function >
+  static const std::uint8_t * decode( const std::uint8_t * cursor, size_t count, Function && function )
+  {
+    std::uint32_t document = 0;
+    std::uint32_t position = 0;
+    for( size_t index = 0; index < count; ++index )
+    {
+      const auto gap = get( cursor );
+      const auto offset = get( cursor );
+      position = gap ? offset : position + offset;
+      document += gap;
+      function( document, position );
+    }
+    return cursor;
+  }
+
+ protected:
+  std::uint32_t document = 0;
+  std::uint32_t position = 0;
+};
+
+/// Compressed postings for one token on its owner.
+///
+/// Postings arrive in batches from chunks tokenized in parallel. Each chunk
+/// covers a disjoint document range and sends in document order, so every
+/// batch forms an ordered segment that never overlaps another. Batches may
+/// arrive in any order, and consecutive ones may split a document, so
+/// segments are encoded as they arrive and put in ( document, position )
+/// order when the shard is sealed.
+///
+class Postings {
+ public:
+  void append( std::uint32_t document, std::uint32_t position, size_t serial )
+  {
+    if( serial != batch || segments.empty() )
+    {
+      batch = serial;
+      segments.push_back( Segment{ bytes.size(), 0, document, position } );
+      encoder = Encoder{};
+    }
+    encoder( bytes, document, position );
+    segments.back().count += 1;
+    total += 1;
+  }
+
+  size_t size() const { return total; }
+
+  /// Re-encode as a single segment in document order.
+  ///
+  std::vector<std::uint8_t> seal()
+  {
+    std::sort( segments.begin(), segments.end(), []( const Segment & a, const Segment & b )
+      {
+        return std::tie( a.document, a.position ) < std::tie( b.document, b.position );
+      });
+
+    std::vector<std::uint8_t> result;
+    result.reserve( bytes.size() );
+    Encoder sealed;
+    for( auto & segment : segments )
+    {
+      Encoder::decode( bytes.data() + segment.offset, segment.count, [&result,&sealed]( std::uint32_t document, std::uint32_t position )
+        {
+          sealed( result, document, position );
+        });
+    }
+    bytes = std::vector<std::uint8_t>{};
+    return result;
+  }
+
+ protected:
+  struct Segment {
+    size_t offset;
+    size_t count;
+    std::uint32_t document;   ///< First document, for ordering.
+    std::uint32_t position;   ///< First position, orders segments splitting a document.
+  };
+
+  std::vector<std::uint8_t> bytes;
+  std::vector<Segment> segments;
+  Encoder encoder;
+  size_t batch = 0;
+  size_t total = 0;
+};
+
+/// On-disk index layout: Header, Entry[terms] sorted by term, term text,
+/// then postings. All offsets are from the start of the file.
+///
+struct Header {
+  char magic[ 8 ];
+  std::uint64_t terms;
+  std::uint64_t documents;
+  std::uint64_t postings;
+};
+
+struct Entry {
+  std::uint64_t text;
+  std::uint64_t postings;
+  std::uint32_t length;
+  std::uint32_t count;
+};
+
+static const char magic[ 8 ] = { 'r', 'a', 'b', 'i', 'd', 'i', 'x', '1' };
+
+/// Builds an inverted index of token -> (document, position).
+///
+/// Documents are the lines of the input.
+///
+///   1. Chunks of whole lines are assigned to workers, which count their
+///      lines. A prefix over the counts numbers every chunk's documents.
+///   2. Workers tokenize their chunks and route postings to token owners
+///      (by token hash) in batches.
+///   3. Owners seal their postings into sorted shards, which are merged into
+///      a single sorted index file.
+///
+class Builder {
+ public:
+  Builder( Exec & executor_arg, const MappedFile & file_arg, size_t batch_arg )
+  : executor( executor_arg )
+  , file( file_arg )
+  , batch( batch_arg )
+  , workers( std::make_unique<Worker[]>( executor.size() ) )
+  , counter( 0 )
+  {}
+
+  struct Timing {
+    std::chrono::steady_clock::duration tokenize;
+    std::chrono::steady_clock::duration seal;
+    std::chrono::steady_clock::duration write;
+  };
+
+  Timing operator()( const std::string & path )
+  {
+    const auto begin = std::chrono::steady_clock::now();
+
+    broadcast( [this]( Worker & worker )
+      {
+        worker.range = bounds( Exec::current() );
+        worker.lines = std::uint32_t( std::count( worker.range.first, worker.range.second, '\n' ) );
+        worker.outbox.assign( executor.size(), std::vector<Posting>{} );
+      });
+
+    std::uint32_t documents = 0;
+    for( size_t index = 0; index < executor.size(); ++index )
+    {
+      workers[ index ].first = documents;
+      documents += workers[ index ].lines;
+    }
+    if( file.size<char>() && text()[ file.size<char>() - 1 ] != '\n' )
+    {
+      documents += 1;
+    }
+
+    broadcast( [this]( Worker & worker )
+      {
+        auto document = worker.first;
+        for( auto line = worker.range.first; line < worker.range.second; ++document )
+        {
+          const auto end = std::find( line, worker.range.second, '\n' );
+          Tokenizer<char> tokenizer{ line, size_t( end - line ) };
+          for( std::uint32_t position = 0; !tokenizer.empty(); ++position )
+          {
+            const auto token = tokenizer.next();
+            const auto target = std::hash<Text>{}( token ) % executor.size();
+            worker.outbox[ target ].push_back( Posting{ token, document, position } );
+            if( worker.outbox[ target ].size() == batch )
+            {
+              shuffle( worker, target );
+            }
+          }
+          line = end + ( end != worker.range.second );
+        }
+        for( size_t target = 0; target < executor.size(); ++target )
+        {
+          if( !worker.outbox[ target ].empty() )
+          {
+            shuffle( worker, target );
+          }
+        }
+      });
+
+    const auto tokenized = std::chrono::steady_clock::now();
+
+    broadcast( []( Worker & worker )
+      {
+        worker.shard.reserve( worker.dictionary.size() );
+        for( auto & term : worker.dictionary )
+        {
+          const auto count = term.second.size();
+          worker.shard.push_back( Sealed{ term.first, std::uint32_t( count ), term.second.seal() } );
+        }
+        worker.dictionary.clear();
+        std::sort( worker.shard.begin(), worker.shard.end(), []( const Sealed & a, const Sealed & b ){ return a.text < b.text; } );
+      });
+
+    const auto sealed = std::chrono::steady_clock::now();
+    write( path, documents );
+    const auto end = std::chrono::steady_clock::now();
+    return Timing{ tokenized - begin, sealed - tokenized, end - sealed };
+  }
+
+ protected:
+  struct Posting {
+    Text token;
+    std::uint32_t document;
+    std::uint32_t position;
+  };
+
+  struct Sealed {
+    Text text;
+    std::uint32_t count;
+    std::vector<std::uint8_t> bytes;
+  };
+
+  struct alignas(64) Worker {
+    std::pair<const char *, const char *> range;
+    std::uint32_t lines = 0;
+    std::uint32_t first = 0;
+    std::vector<std::vector<Posting>> outbox;
+    std::unordered_map<Text, Postings> dictionary;
+    size_t serial = 0;
+    std::vector<Sealed> shard;
+  };
+
+  const char * text() const { return file.array<char>(); }
+
+  /// Chunk boundaries, rounded forward to line starts.
+  ///
+  std::pair<const char *, const char *> bounds( size_t index ) const
+  {
+    const auto end = text() + file.size<char>();
+    const auto align = [this,end]( size_t chunk )
+    {
+      if( chunk == 0 || chunk == executor.size() )
+      {
+        return chunk ? end : text();
+      }
+      const auto start = text() + file.size<char>() * chunk / executor.size();
+      const auto newline = std::find( std::max( start - 1, text() ), end, '\n' );
+      return newline + ( newline != end );
+    };
+    return { align( index ), align( index + 1 ) };
+  }
+
+  void shuffle( Worker & worker, size_t target )
+  {
+    counter.increment();
+    Exec::async( target, [this,postings = std::move( worker.outbox[ target ] )]
+      {
+        auto & owner = workers[ Exec::current() ];
+        owner.serial += 1;
+        for( auto & posting : postings )
+        {
+          owner.dictionary[ posting.token ].append( posting.document, posting.position, owner.serial );
+        }
+        counter.decrement();
+      });
+    worker.outbox[ target ] = std::vector<Posting>{};
+    worker.outbox[ target ].reserve( batch );
+  }
+
+  /// Merge the sorted shards into the index file.
+  ///
+  void write( const std::string & path, std::uint32_t documents )
+  {
+    using Cursor = std::pair<const Sealed *, const Sealed *>;
+    const auto later = []( const Cursor & a, const Cursor & b ){ return b.first->text < a.first->text; };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype( later )> heads{ later };
+    size_t terms = 0;
+    for( size_t index = 0; index < executor.size(); ++index )
+    {
+      auto & shard = workers[ index ].shard;
+      if( !shard.empty() )
+      {
+        heads.emplace( shard.data(), shard.data() + shard.size() );
+      }
+      terms += shard.size();
+    }
+
+    std::vector<const Sealed *> order;
+    order.reserve( terms );
+    while( !heads.empty() )
+    {
+      auto head = heads.top();
+      heads.pop();
+      order.push_back( head.first );
+      if( ++head.first != head.second )
+      {
+        heads.push( head );
+      }
+    }
+
+    std::uint64_t text_offset = sizeof( Header ) + terms * sizeof( Entry );
+    std::uint64_t postings_offset = text_offset;
+    for( auto term : order )
+    {
+      postings_offset += term->text.size();
+    }
+
+    Header header;
+    std::memcpy( header.magic, magic, sizeof( magic ) );
+    header.terms = terms;
+    header.documents = documents;
+    header.postings = postings_offset;
+
+    std::ofstream stream{ path, std::ios::binary };
+    stream.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    for( auto term : order )
+    {
+      const Entry entry{ text_offset, postings_offset, std::uint32_t( term->text.size() ), term->count };
+      stream.write( reinterpret_cast<const char *>( &entry ), sizeof( entry ) );
+      text_offset += term->text.size();
+      postings_offset += term->bytes.size();
+    }
+    for( auto term : order )
+    {
+      stream.write( term->text.begin, std::streamsize( term->text.size() ) );
+    }
+    for( auto term : order )
+    {
+      stream.write( reinterpret_cast<const char *>( term->bytes.data() ), std::streamsize( term->bytes.size() ) );
+    }
+  }
+
+  template < typename Function >
+  void broadcast( Function && function )
+  {
+    executor.each( counter, [this,&function]( size_t index ){ function( workers[ index ] ); } );
+  }
+
+  Exec & executor;
+  const MappedFile & file;
+  const size_t batch;
+  std::unique_ptr<Worker[]> workers;
+  rabid::detail::Counter counter;
+};
+
+/// Read-only view of an index file.
+///
+class Index {
+ public:
+  Index( const std::string & path )
+  : file( path )
+  {}
+
+  bool valid() const
+  {
+    return file.size<char>() >= sizeof( Header ) && std::memcmp( header().magic, magic, sizeof( magic ) ) == 0;
+  }
+
+  size_t terms() const { return header().terms; }
+  size_t documents() const { return header().documents; }
+  size_t bytes() const { return file.size<char>(); }
+
+  /// Look up a term, calling function( document, position ) per posting.
+  ///
+  /// @return number of postings.
+  ///
+  template < typename Function >
+  size_t lookup( const Text & term, Function && function ) const
+  {
+    const auto entries = reinterpret_cast<const Entry *>( file.array<char>() + sizeof( Header ) );
+    const auto last = entries + terms();
+    const auto entry = std::lower_bound( entries, last, term, [this]( const Entry & a, const Text & b ){ return text( a ) < b; } );
+    if( entry == last || !( text( *entry ) == term ) )
+    {
+      return 0;
+    }
+    Encoder::decode( reinterpret_cast<const std::uint8_t *>( file.array<char>() + entry->postings ), entry->count, function );
+    return entry->count;
+  }
+
+ protected:
+  const Header & header() const { return *reinterpret_cast<const Header *>( file.array<char>() ); }
+
+  Text text( const Entry & entry ) const
+  {
+    const auto begin = file.array<char>() + entry.text;
+    return Text{ begin, begin + entry.length };
+  }
+
+  MappedFile file;
+};
+
+int main( int argc, char ** argv )
+{
+  if( argc < 2 )
+  {
+    std::cerr << "usage: " << argv[ 0 ] << " <file> [index] [concurrency] [batch]" << std::endl;
+    return 1;
+  }
+
+  MappedFile file{ argv[ 1 ] };
+  const std::string path = ( argc > 2 ? argv[ 2 ] : std::string{ argv[ 1 ] } + ".index" );
+  const size_t concurrency = ( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
+  const size_t batch = ( argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : 1024 );
+
+  std::cout << "Warmed up: " << file.warm() << std::endl;
+
+  Builder::Timing timing;
+  placement::Matrix traffic;
+  {
+    Exec executor{ concurrency };
+    Builder builder{ executor, file, batch };
+    timing = builder( path );
+    traffic = placement::traffic( executor );
+  }
+  std::cout << "tokenize/shuffle: " << std::chrono::duration_cast<std::chrono::microseconds>( timing.tokenize ).count() << " usec" << std::endl;
+  std::cout << "seal: " << std::chrono::duration_cast<std::chrono::microseconds>( timing.seal ).count() << " usec" << std::endl;
+  std::cout << "merge/write: " << std::chrono::duration_cast<std::chrono::microseconds>( timing.write ).count() << " usec" << std::endl;
+
+  const auto cores = placement::topology();
+  std::cout << "cross-socket messages: " << placement::cross_socket( traffic, cores, placement::linear( concurrency, cores ) )
+    << " linear, " << placement::cross_socket( traffic, cores, placement::optimize( traffic, cores ) ) << " optimized" << std::endl;
+
+  // Verify against a sequential build of the same postings.
+  //
+  using Reference = std::map<std::string, std::vector<std::pair<std::uint32_t,std::uint32_t>>>;
+  Reference reference;
+  size_t postings = 0;
+  {
+    const auto text = file.array<char>();
+    const auto end = text + file.size<char>();
+    std::uint32_t document = 0;
+    for( auto line = text; line < end; ++document )
+    {
+      const auto stop = std::find( line, end, '\n' );
+      Tokenizer<char> tokenizer{ line, size_t( stop - line ) };
+      for( std::uint32_t position = 0; !tokenizer.empty(); ++position )
+      {
+        const auto token = tokenizer.next();
+        reference[ std::string( token.begin, token.end ) ].emplace_back( document, position );
+        postings += 1;
+      }
+      line = stop + ( stop != end );
+    }
+  }
+
+  Index index{ path };
+  bool match = index.valid() && index.terms() == reference.size();
+  for( auto & term : reference )
+  {
+    std::vector<std::pair<std::uint32_t,std::uint32_t>> found;
+    const Text text{ term.first.data(), term.first.data() + term.first.size() };
+    index.lookup( text, [&found]( std::uint32_t document, std::uint32_t position ){ found.emplace_back( document, position ); } );
+    match = match && found == term.second;
+  }
+
+  std::cout << index.terms() << " terms, " << index.documents() << " documents, " << postings << " postings, "
+    << index.bytes() << " bytes (" << double( index.bytes() ) / double( postings ) << " bytes/posting)" << std::endl;
+  std::cout << ( match ? "matches reference" : "MISMATCH" ) << std::endl;
+  return match ? 0 : 1;
+}
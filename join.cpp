@@ -0,0 +1,416 @@
+
+#include <limits>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <cmath>
+
+#include "include/Executor.h"
+
+using namespace rabid;
+
+using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+
+struct Tuple {
+  std::uint64_t key;
+  std::uint64_t payload;
+};
+
+struct Match {
+  std::uint64_t key;
+  std::uint64_t build;
+  std::uint64_t probe;
+};
+
+/// Zipf distributed ranks in [0,n).
+///
+/// A skew of zero is uniform; larger skews concentrate on low ranks.
+///
+class Zipf {
+ public:
+  Zipf( size_t n, double skew )
+  : cdf( n )
+  {
+    double sum = 0;
+    for( size_t rank = 0; rank < n; ++rank )
+    {
+      sum += 1.0 / std::pow( double( rank + 1 ), skew );
+      cdf[ rank ] = sum;
+    }
+    for( auto & value : cdf )
+    {
+      value /= sum;
+    }
+  }
+
+  template < typename Random >
+  size_t operator()( Random & random ) const
+  {
+    const auto target = std::uniform_real_distribution<double>{}( random );
+    const auto position = std::lower_bound( cdf.begin(), cdf.end(), target );
+    return std::min( size_t( position - cdf.begin() ), cdf.size() - 1 );
+  }
+
+ protected:
+  std::vector<double> cdf;
+};
+
+/// Build side: unique keys [0,n) in random order.
+///
+std::vector<Tuple> primary( size_t n, std::uint64_t seed )
+{
+  std::mt19937_64 random{ seed };
+  std::vector<Tuple> result( n );
+  for( size_t index = 0; index < n; ++index )
+  {
+    result[ index ] = Tuple{ index, random() };
+  }
+  std::shuffle( result.begin(), result.end(), random );
+  return result;
+}
+
+/// Probe side: keys drawn from [0,keys) with zipf skew.
+///
+std::vector<Tuple> foreign( size_t n, size_t keys, double skew, std::uint64_t seed )
+{
+  std::mt19937_64 random{ seed };
+  const Zipf zipf{ keys, skew };
+  std::vector<Tuple> result( n );
+  for( auto & tuple : result )
+  {
+    tuple = Tuple{ zipf( random ), random() };
+  }
+  return result;
+}
+
+inline std::uint64_t hash( std::uint64_t key )
+{
+  return key * 0x9E3779B97F4A7C15ull;
+}
+
+inline std::uint64_t fold( const Match & match )
+{
+  return hash( match.key ^ match.build ) + match.probe;
+}
+
+/// Open-addressing hash table over a partition's build tuples.
+///
+/// Slots hold 1 + the index of a build tuple, with 0 marking an empty slot.
+/// Collisions and duplicate keys probe linearly.
+///
+class FlatTable {
+ public:
+  void build( const std::vector<Tuple> & tuples_arg )
+  {
+    tuples = &tuples_arg;
+    size_t capacity = 16;
+    while( capacity < tuples->size() * 2 )
+    {
+      capacity *= 2;
+    }
+    mask = capacity - 1;
+    slots.assign( capacity, 0 );
+
+    for( size_t index = 0; index < tuples->size(); ++index )
+    {
+      auto slot = position( (*tuples)[ index ].key );
+      while( slots[ slot ] )
+      {
+        slot = ( slot + 1 ) & mask;
+      }
+      slots[ slot ] = std::uint32_t( index + 1 );
+    }
+  }
+
+  template < typename Function >
+  void probe( const Tuple & tuple, Function && function ) const
+  {
+    for( auto slot = position( tuple.key ); slots[ slot ]; slot = ( slot + 1 ) & mask )
+    {
+      const auto & candidate = (*tuples)[ slots[ slot ] - 1 ];
+      if( candidate.key == tuple.key )
+      {
+        function( Match{ tuple.key, candidate.payload, tuple.payload } );
+      }
+    }
+  }
+
+ protected:
+  /// Partitioning consumes the high hash bits, so index by the middle ones.
+  ///
+  size_t position( std::uint64_t key ) const { return ( hash( key ) >> 16 ) & mask; }
+
+  const std::vector<Tuple> * tuples = nullptr;
+  std::vector<std::uint32_t> slots;
+  size_t mask = 0;
+};
+
+/// Radix-partitioned parallel hash join.
+///
+/// Keys hash to 2^radix partitions (a single one for radix 0), and partition
+/// P is owned by worker P % workers. Using more partitions than workers
+/// keeps each hash table small enough to stay in cache.
+///
+///   1. Shuffle: each worker scans a contiguous chunk of both relations and
+///      sends tuples to their partition owners in batches.
+///   2. Build/probe: each owner builds a flat table per partition from the
+///      build side, then probes it with the probe side.
+///   3. Consume: matches stream to consumer workers in batches, round-robin,
+///      overlapping with the probes that produce them.
+///
+class HashJoin {
+ public:
+  struct Result {
+    size_t matches;
+    std::uint64_t checksum;
+    std::chrono::steady_clock::duration shuffle;
+    std::chrono::steady_clock::duration join;
+    double imbalance;   ///< Max tuples per owner relative to the mean.
+  };
+
+  HashJoin( Exec & executor_arg, size_t batch_arg, size_t radix_arg )
+  : executor( executor_arg )
+  , batch( batch_arg )
+  , radix( radix_arg )
+  , owners( std::make_unique<Owner[]>( executor.size() ) )
+  , counter( 0 )
+  {}
+
+  Result operator()( const std::vector<Tuple> & build, const std::vector<Tuple> & probe )
+  {
+    const std::vector<Tuple> * relations[ 2 ] = { &build, &probe };
+    const size_t partitions = size_t{1} << radix;
+
+    broadcast( [this,partitions]( Owner & owner )
+      {
+        const auto local = ( partitions - Exec::current() + executor.size() - 1 ) / executor.size();
+        for( auto & relation : owner.partitions )
+        {
+          relation.assign( local, std::vector<Tuple>{} );
+        }
+        for( auto & outbox : owner.outbox )
+        {
+          outbox.assign( executor.size(), std::vector<Tuple>{} );
+        }
+        owner.matches = 0;
+        owner.checksum = 0;
+        owner.consumer = Exec::current();
+      });
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    broadcast( [this,&relations]( Owner & owner )
+      {
+        for( size_t relation = 0; relation < 2; ++relation )
+        {
+          const auto & tuples = *relations[ relation ];
+          const auto first = tuples.size() * Exec::current() / executor.size();
+          const auto last = tuples.size() * ( Exec::current() + 1 ) / executor.size();
+          auto & outbox = owner.outbox[ relation ];
+          for( auto tuple = tuples.begin() + ssize_t( first ); tuple != tuples.begin() + ssize_t( last ); ++tuple )
+          {
+            const auto target = partition( tuple->key ) % executor.size();
+            outbox[ target ].push_back( *tuple );
+            if( outbox[ target ].size() == batch )
+            {
+              shuffle( owner, relation, target );
+            }
+          }
+          for( size_t target = 0; target < outbox.size(); ++target )
+          {
+            if( !outbox[ target ].empty() )
+            {
+              shuffle( owner, relation, target );
+            }
+          }
+        }
+      });
+
+    const auto middle = std::chrono::steady_clock::now();
+
+    broadcast( [this]( Owner & owner )
+      {
+        FlatTable table;
+        for( size_t local = 0; local < owner.partitions[ 0 ].size(); ++local )
+        {
+          table.build( owner.partitions[ 0 ][ local ] );
+          for( auto & tuple : owner.partitions[ 1 ][ local ] )
+          {
+            table.probe( tuple, [&]( const Match & match )
+              {
+                owner.output.push_back( match );
+                if( owner.output.size() == batch )
+                {
+                  consume( owner );
+                }
+              });
+          }
+        }
+        if( !owner.output.empty() )
+        {
+          consume( owner );
+        }
+      });
+
+    const auto end = std::chrono::steady_clock::now();
+
+    Result result{ 0, 0, middle - begin, end - middle, 0 };
+    size_t heaviest = 0;
+    size_t total = 0;
+    for( size_t index = 0; index < executor.size(); ++index )
+    {
+      auto & owner = owners[ index ];
+      result.matches += owner.matches;
+      result.checksum += owner.checksum;
+
+      size_t load = 0;
+      for( auto & relation : owner.partitions )
+      {
+        for( auto & tuples : relation )
+        {
+          load += tuples.size();
+        }
+      }
+      heaviest = std::max( heaviest, load );
+      total += load;
+    }
+    result.imbalance = double( heaviest ) * double( executor.size() ) / double( total );
+    return result;
+  }
+
+ protected:
+  struct alignas(64) Owner {
+    std::vector<std::vector<Tuple>> partitions[ 2 ];  ///< Owned partitions of each relation.
+    std::vector<std::vector<Tuple>> outbox[ 2 ];      ///< Shuffle batches per destination.
+    std::vector<Match> output;
+    size_t consumer;
+    size_t matches;
+    std::uint64_t checksum;
+  };
+
+  /// Select a key's partition from the top radix bits of its hash.
+  ///
+  size_t partition( std::uint64_t key ) const { return radix ? hash( key ) >> ( 64 - radix ) : 0; }
+
+  /// Run a function on every worker and wait for it and every message it
+  /// (transitively) sends to finish.
+  ///
+  template < typename Function >
+  void broadcast( Function && function )
+  {
+    executor.each( counter, [this,&function]( size_t index ){ function( owners[ index ] ); } );
+  }
+
+  void shuffle( Owner & owner, size_t relation, size_t target )
+  {
+    counter.increment();
+    Exec::async( target, [this,relation,tuples = std::move( owner.outbox[ relation ][ target ] )]
+      {
+        auto & destination = owners[ Exec::current() ].partitions[ relation ];
+        for( auto & tuple : tuples )
+        {
+          destination[ partition( tuple.key ) / executor.size() ].push_back( tuple );
+        }
+        counter.decrement();
+      });
+    owner.outbox[ relation ][ target ] = std::vector<Tuple>{};
+    owner.outbox[ relation ][ target ].reserve( batch );
+  }
+
+  void consume( Owner & owner )
+  {
+    owner.consumer = ( owner.consumer + 1 ) % executor.size();
+    counter.increment();
+    Exec::async( owner.consumer, [this,matches = std::move( owner.output )]
+      {
+        auto & consumer = owners[ Exec::current() ];
+        consumer.matches += matches.size();
+        for( auto & match : matches )
+        {
+          consumer.checksum += fold( match );
+        }
+        counter.decrement();
+      });
+    owner.output = std::vector<Match>{};
+    owner.output.reserve( batch );
+  }
+
+  Exec & executor;
+  const size_t batch;
+  const size_t radix;
+  std::unique_ptr<Owner[]> owners;
+  rabid::detail::Counter counter;
+};
+
+/// Single-threaded reference join.
+///
+auto join_with_map( const std::vector<Tuple> & build, const std::vector<Tuple> & probe )
+  -> std::pair<std::chrono::steady_clock::duration, std::pair<size_t, std::uint64_t>>
+{
+  const auto begin = std::chrono::steady_clock::now();
+  std::unordered_multimap<std::uint64_t, std::uint64_t> table;
+  table.reserve( build.size() );
+  for( auto & tuple : build )
+  {
+    table.emplace( tuple.key, tuple.payload );
+  }
+
+  size_t matches = 0;
+  std::uint64_t checksum = 0;
+  for( auto & tuple : probe )
+  {
+    const auto range = table.equal_range( tuple.key );
+    for( auto entry = range.first; entry != range.second; ++entry )
+    {
+      matches += 1;
+      checksum += fold( Match{ tuple.key, entry->second, tuple.payload } );
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return { end - begin, { matches, checksum } };
+}
+
+int main( int argc, char ** argv )
+{
+  const size_t build_size = ( argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 1 << 20 );
+  const size_t probe_size = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 1 << 22 );
+  const size_t max_concurrency = ( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
+  const size_t batch = ( argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : 1024 );
+  const size_t radix = ( argc > 5 ? strtoul( argv[ 5 ], nullptr, 10 ) : 10 );
+  if( radix > 32 )
+  {
+    std::cerr << "radix must be at most 32 bits" << std::endl;
+    return 1;
+  }
+
+  const auto build = primary( build_size, 1 );
+  for( const double skew : { 0.0, 0.5, 1.0, 1.5 } )
+  {
+    const auto probe = foreign( probe_size, build_size, skew, 2 );
+    const auto reference = join_with_map( build, probe );
+    std::cout << "skew " << skew << ": reference "
+      << std::chrono::duration_cast<std::chrono::microseconds>( reference.first ).count() << " usec, "
+      << reference.second.first << " matches" << std::endl;
+
+    for( size_t concurrency = 1; concurrency <= max_concurrency; concurrency *= 2 )
+    {
+      Exec executor{ concurrency };
+      HashJoin join{ executor, batch, radix };
+      const auto result = join( build, probe );
+      const auto total = result.shuffle + result.join;
+      std::cout << "  concurrency " << concurrency << ": "
+        << std::chrono::duration_cast<std::chrono::microseconds>( total ).count() << " usec ("
+        << std::chrono::duration_cast<std::chrono::microseconds>( result.shuffle ).count() << " shuffle, "
+        << std::chrono::duration_cast<std::chrono::microseconds>( result.join ).count() << " build/probe), "
+        << double( build.size() + probe.size() ) / double( std::chrono::duration_cast<std::chrono::microseconds>( total ).count() ) << " Mtuples/s, "
+        << "imbalance " << result.imbalance
+        << ( result.matches == reference.second.first && result.checksum == reference.second.second ? "" : ", MISMATCH" )
+        << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -40,6 +40,7 @@ auto overhead_executor_copy( size_t iterations,
   Join join{ ssize_t(jobs) };
   const auto begin = std::chrono::steady_clock::now();
 
+  executor.wake();
   for( size_t job = 0; job < jobs; ++job )
   {
     executor.inject( job % concurrency, Job{ iterations, 0, join } );
@@ -83,6 +84,7 @@ auto overhead_executor_defer( size_t iterations,
   Join join{ ssize_t(jobs) };
   const auto begin = std::chrono::steady_clock::now();
 
+  executor.wake();
   for( size_t job = 0; job < jobs; ++job )
   {
     executor.inject( job % concurrency, Job{ iterations, 0, join } );
@@ -127,6 +129,7 @@ auto rotate_executor_copy( size_t iterations,
   Join join{ ssize_t(jobs) };
   const auto begin = std::chrono::steady_clock::now();
 
+  executor.wake();
   for( size_t job = 0; job < jobs; ++job )
   {
     executor.inject( job % concurrency, Job{ iterations, 0, join } );
@@ -171,6 +174,7 @@ auto rotate_executor_defer( size_t iterations,
   Join join{ ssize_t(jobs) };
   const auto begin = std::chrono::steady_clock::now();
 
+  executor.wake();
   for( size_t job = 0; job < jobs; ++job )
   {
     executor.inject( job % concurrency, Job{ iterations, 0, join } );
@@ -181,12 +185,37 @@ auto rotate_executor_defer( size_t iterations,
   return end - begin;
 }
 
+/// Time to create an executor, run one task on it, and destroy it.
+///
+/// The first call spawns the registry's threads; later calls borrow them.
+///
+auto startup_executor( size_t concurrency = std::thread::hardware_concurrency() )
+  -> std::chrono::steady_clock::duration
+{
+  using Exec = rabid::Executor<rabid::interconnect::Direct, rabid::execution::ThreadModel >;
+
+  const auto begin = std::chrono::steady_clock::now();
+  {
+    Exec executor{ concurrency };
+    rabid::detail::Join join{ 1 };
+    executor.inject( 0, [&join]{ join.notify(); } );
+    join.wait();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return end - begin;
+}
+
 int main( int argc, char ** argv )
 {
   const size_t iterations = ( argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 10000 );
   const size_t concurrency = ( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : std::thread::hardware_concurrency() );
   const size_t job_multipler = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : concurrency * concurrency );
 
+  for( const char * label : { "startup (spawn)", "startup (reuse)" } )
+  {
+    const auto duration = startup_executor( concurrency );
+    std::cout << label << ": " << std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() << " usec" << std::endl;
+  }
   {
     const auto duration = overhead_executor_copy( iterations, job_multipler, concurrency );
     std::cout << std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() << " usec" << std::endl;
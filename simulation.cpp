@@ -0,0 +1,350 @@
+
+#include <algorithm>
+#include <limits>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+
+#include "include/interconnect.h"
+
+using namespace rabid;
+
+/// Synthetic message driven through an interconnect by the simulator.
+///
+/// Probes are re-addressed to a random node each time they are delivered,
+/// until they have been delivered 'remaining' times.
+///
+struct Probe : interconnect::Message {
+  using interconnect::Message::Message;
+
+  std::chrono::steady_clock::time_point sent;
+  size_t sweep = 0;
+  size_t remaining = 0;
+  size_t origin = 0;
+};
+
+/// Routed hypercube interconnect, for comparison with Direct.
+///
+/// Node i connects to the nodes whose index differs from i in one bit, so
+/// each node has O(log N) connections rather than N. Messages for other nodes
+/// are forwarded a bit at a time. Routes clear differing bits before setting
+/// them, so every intermediate index stays below the node count even when it
+/// is not a power of two.
+///
+class Hypercube {
+ public:
+  /// Address map from destination to the connection of the next hop.
+  ///
+  class Ports {
+   public:
+    Ports( size_t self_arg, std::vector<size_t> ports_arg )
+    : self( self_arg )
+    , ports( std::move( ports_arg ) )
+    {}
+
+    size_t operator()( size_t address ) const
+    {
+      if( address == self )
+      {
+        return 0;
+      }
+      const auto clear = self & ~address;
+      const auto bit = ( clear ? clear : address & ~self );
+      return ports[ size_t( __builtin_ctzll( bit ) ) ];
+    }
+
+    bool terminal( const interconnect::Message::PointerType & message ) const { return message->address == self; }
+
+   protected:
+    size_t self;
+    std::vector<size_t> ports;
+  };
+
+  using NodeType = interconnect::Node<Ports>;
+  const NodeType & node( size_t index ) const { return nodes[ index ]; }
+
+  Hypercube( size_t count )
+  : dimensions( dimensions_for( count ) )
+  , buffers( std::make_unique<interconnect::Buffer[]>( count * ( dimensions + 1 ) ) )
+  {
+    nodes.reserve( count );
+    for( size_t index = 0; index < count; ++index )
+    {
+      std::vector<interconnect::Connection> connections;
+      std::vector<size_t> ports( dimensions, 0 );
+      connections.emplace_back( buffer_for_edge( index, 0 ), buffer_for_edge( index, 0 ) );
+      for( size_t dimension = 0; dimension < dimensions; ++dimension )
+      {
+        const auto neighbor = index ^ ( size_t( 1 ) << dimension );
+        if( neighbor < count )
+        {
+          ports[ dimension ] = connections.size();
+          connections.emplace_back( buffer_for_edge( index, dimension + 1 ), buffer_for_edge( neighbor, dimension + 1 ) );
+        }
+      }
+      nodes.emplace_back( std::move( connections ), index, std::move( ports ) );
+    }
+  }
+
+  /// Query the number of hops between two nodes.
+  ///
+  static size_t distance( size_t source, size_t destination )
+  {
+    return size_t( __builtin_popcountll( source ^ destination ) );
+  }
+
+  /// Query the number of bytes allocated for buffers, connections and
+  /// forwarding groups.
+  ///
+  size_t footprint() const
+  {
+    size_t bytes = nodes.size() * ( dimensions + 1 ) * sizeof( interconnect::Buffer );
+    for( auto & node : nodes )
+    {
+      bytes += node.footprint();
+    }
+    return bytes;
+  }
+
+ protected:
+  static size_t dimensions_for( size_t count )
+  {
+    size_t result = 0;
+    while( ( size_t( 1 ) << result ) < count )
+    {
+      result += 1;
+    }
+    return result;
+  }
+
+  /// Each node owns its loopback buffer (port 0) and one outbound buffer per
+  /// dimension (port dimension + 1), which its neighbor across that
+  /// dimension receives from.
+  ///
+  interconnect::Buffer & buffer_for_edge( size_t node, size_t port ) const
+  {
+    return buffers[ node * ( dimensions + 1 ) + port ];
+  }
+
+  const size_t dimensions;
+  std::unique_ptr<interconnect::Buffer[]> buffers;
+  std::vector<NodeType> nodes;
+};
+
+/// Every Direct delivery is a single hop.
+///
+size_t distance( const interconnect::Direct &, size_t, size_t ) { return 1; }
+
+size_t distance( const Hypercube &, size_t source, size_t destination )
+{
+  return std::max( Hypercube::distance( source, destination ), size_t( 1 ) );
+}
+
+/// Prepare functor that leaves the receiving list intact.
+///
+/// The simulator never publishes sentinels, so there is nothing to filter.
+///
+struct Passthrough {
+  interconnect::Message::PointerType operator() ( const interconnect::Message::PointerType & prior ) const { return prior; }
+};
+
+/// Measurements for a single simulated interconnect size.
+///
+struct Report {
+  size_t nodes = 0;
+  size_t footprint = 0;
+  size_t sweeps = 0;
+  size_t deliveries = 0;
+  size_t forwards = 0;
+  size_t batches = 0;
+  double sweep_ns = 0;
+  double mean_sweeps = 0;
+  size_t p99_sweeps = 0;
+  double mean_ns = 0;
+  double p99_ns = 0;
+};
+
+/// Drive synthetic traffic through N logical nodes from a single thread.
+///
+/// Each logical node is swept in turn via the real Node::operate(), so the
+/// per-node polling cost, forwarding, and buffer layout are exactly those an
+/// Executor would see--only the parallelism is simulated. Latency is reported
+/// both in sweeps (the portable measure) and in wall time (inflated by N,
+/// since one thread does the work of all nodes).
+///
+/// @tparam Interconnect Type of interconnect to simulate.
+/// @param nodes Number of logical nodes.
+/// @param probes Number of messages in flight per node.
+/// @param deliveries Number of times each message is delivered before retiring.
+/// @param idle_sweeps Number of empty sweeps used to measure polling cost.
+///
+template < typename Interconnect >
+Report simulate( size_t nodes, size_t probes, size_t deliveries, size_t idle_sweeps = 16 )
+{
+  using clock = std::chrono::steady_clock;
+
+  Interconnect interconnect{ nodes };
+  std::mt19937_64 random{ nodes };
+  std::uniform_int_distribution<size_t> destination{ 0, nodes - 1 };
+
+  std::vector<size_t> latency_sweeps;
+  std::vector<clock::duration> latency_time;
+  latency_sweeps.reserve( nodes * probes * deliveries );
+  latency_time.reserve( nodes * probes * deliveries );
+
+  Report report;
+  report.nodes = nodes;
+  report.footprint = interconnect.footprint();
+
+  struct Agent {
+    Interconnect & interconnect;
+    Report & report;
+    std::mt19937_64 & random;
+    std::uniform_int_distribution<size_t> & destination;
+    std::vector<size_t> & latency_sweeps;
+    std::vector<clock::duration> & latency_time;
+    size_t current;
+    size_t retired;
+
+    TaggedPointer<interconnect::Message> sentinel() const { return TaggedPointer<interconnect::Message>{ nullptr }; }
+
+    /// Called once per group of forwarded messages.
+    ///
+    Passthrough preparer()
+    {
+      report.batches += 1;
+      return Passthrough{};
+    }
+
+    void receive( const TaggedPointer<interconnect::Message> & message, size_t )
+    {
+      auto & probe = static_cast<Probe&>( *message );
+      const auto now = clock::now();
+      latency_sweeps.push_back( report.sweeps - probe.sweep );
+      latency_time.push_back( now - probe.sent );
+      report.deliveries += 1;
+      report.forwards += distance( interconnect, probe.origin, current ) - 1;
+
+      if( --probe.remaining )
+      {
+        probe.address = static_cast<std::uint32_t>( destination( random ) );
+        probe.sweep = report.sweeps;
+        probe.sent = now;
+        probe.origin = current;
+        interconnect.node( current ).send( message, Passthrough{} );
+      }
+      else
+      {
+        retired += 1;
+      }
+    }
+  };
+
+  Agent agent{ interconnect, report, random, destination, latency_sweeps, latency_time, 0, 0 };
+
+  std::vector<Probe> pool;
+  pool.reserve( nodes * probes );
+  for( size_t index = 0; index < nodes * probes; ++index )
+  {
+    pool.emplace_back( destination( random ) );
+    auto & probe = pool.back();
+    probe.remaining = deliveries;
+    probe.sent = clock::now();
+    probe.origin = index % nodes;
+    interconnect.node( index % nodes ).send( interconnect::Message::PointerType{ &probe }, Passthrough{} );
+  }
+
+  // Drive traffic until every probe retires.
+  //
+  while( agent.retired < pool.size() )
+  {
+    for( size_t index = 0; index < nodes; ++index )
+    {
+      agent.current = index;
+      interconnect.node( index ).operate( agent );
+    }
+    report.sweeps += 1;
+  }
+
+  // Measure the cost of polling an idle interconnect.
+  //
+  const auto begin = clock::now();
+  for( size_t sweep = 0; sweep < idle_sweeps; ++sweep )
+  {
+    for( size_t index = 0; index < nodes; ++index )
+    {
+      interconnect.node( index ).operate( agent );
+    }
+  }
+  const auto end = clock::now();
+  report.sweep_ns = double( std::chrono::duration_cast<std::chrono::nanoseconds>( end - begin ).count() ) / double( idle_sweeps * nodes );
+
+  // Without deliveries (i.e. zero probes) there is no latency to report.
+  //
+  if( latency_sweeps.empty() )
+  {
+    return report;
+  }
+
+  const auto p99 = latency_sweeps.size() * 99 / 100;
+  std::nth_element( latency_sweeps.begin(), latency_sweeps.begin() + ssize_t(p99), latency_sweeps.end() );
+  std::nth_element( latency_time.begin(), latency_time.begin() + ssize_t(p99), latency_time.end() );
+  report.p99_sweeps = latency_sweeps[ p99 ];
+  report.p99_ns = double( std::chrono::duration_cast<std::chrono::nanoseconds>( latency_time[ p99 ] ).count() );
+
+  double sweeps = 0;
+  double time = 0;
+  for( size_t index = 0; index < latency_sweeps.size(); ++index )
+  {
+    sweeps += double( latency_sweeps[ index ] );
+    time += double( std::chrono::duration_cast<std::chrono::nanoseconds>( latency_time[ index ] ).count() );
+  }
+  report.mean_sweeps = sweeps / double( latency_sweeps.size() );
+  report.mean_ns = time / double( latency_time.size() );
+  return report;
+}
+
+std::ostream & header( std::ostream & stream )
+{
+  return stream << std::setw( 10 ) << "topology"
+    << std::setw( 8 ) << "nodes"
+    << std::setw( 14 ) << "buffer bytes"
+    << std::setw( 14 ) << "sweep ns/node"
+    << std::setw( 10 ) << "hops"
+    << std::setw( 12 ) << "fwd/batch"
+    << std::setw( 12 ) << "mean sweeps"
+    << std::setw( 11 ) << "p99 sweeps"
+    << std::setw( 12 ) << "mean usec"
+    << std::setw( 12 ) << "p99 usec" << std::endl;
+}
+
+std::ostream & operator << ( std::ostream & stream, const Report & report )
+{
+  return stream << std::setw( 8 ) << report.nodes
+    << std::setw( 14 ) << report.footprint
+    << std::setw( 14 ) << std::fixed << std::setprecision( 1 ) << report.sweep_ns
+    << std::setw( 10 ) << std::setprecision( 3 ) << ( report.deliveries ? 1.0 + double( report.forwards ) / double( report.deliveries ) : 0.0 )
+    << std::setw( 12 ) << std::setprecision( 2 ) << ( report.batches ? double( report.forwards ) / double( report.batches ) : 0.0 )
+    << std::setw( 12 ) << std::setprecision( 2 ) << report.mean_sweeps
+    << std::setw( 11 ) << report.p99_sweeps
+    << std::setw( 12 ) << std::setprecision( 1 ) << report.mean_ns / 1000.0
+    << std::setw( 12 ) << report.p99_ns / 1000.0;
+}
+
+int main( int argc, char ** argv )
+{
+  const size_t max_nodes = ( argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 256 );
+  const size_t probes = ( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 4 );
+  const size_t deliveries = ( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : 64 );
+
+  header( std::cout );
+  for( size_t nodes = 2; nodes <= max_nodes; nodes *= 2 )
+  {
+    std::cout << std::setw( 10 ) << "direct" << simulate<interconnect::Direct>( nodes, probes, deliveries ) << std::endl;
+    std::cout << std::setw( 10 ) << "hypercube" << simulate<Hypercube>( nodes, probes, deliveries ) << std::endl;
+  }
+
+  return 0;
+}
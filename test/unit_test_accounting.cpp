@@ -0,0 +1,111 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <future.h>
+
+using namespace rabid;
+
+// Built as a separate executable with RABID_ACCOUNTING defined.
+//
+static_assert( accounting::enabled(), "accounting tests require RABID_ACCOUNTING" );
+
+SCENARIO( "allocations should be counted by kind" )
+{
+  GIVEN( "a promise with continuations" )
+  {
+    accounting::Scope scope;
+    {
+      Promise<int> promise;
+      size_t result = 0;
+      promise.then( []( int & value ){ return value + 1; } )
+        .then( [&result]( int & value ){ result = size_t( value ); } );
+      promise.complete( 41 );
+
+      REQUIRE( result == 42 );
+      REQUIRE( scope.delta( accounting::Kind::promise ).allocations == 1 );
+      REQUIRE( scope.delta( accounting::Kind::continuation ).allocations == 2 );
+      REQUIRE( scope.delta( accounting::Kind::task ).allocations == 0 );
+    }
+
+    THEN( "everything should be freed once released" )
+    {
+      const auto delta = scope.delta();
+      REQUIRE( delta.allocations == 3 );
+      REQUIRE( delta.deallocations == 3 );
+      REQUIRE( delta.allocated == delta.freed );
+    }
+  }
+}
+
+SCENARIO( "executor allocations should be charged to workers" )
+{
+  GIVEN( "an executor" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    const size_t tasks = 100;
+    const auto live = accounting::totals().live();
+
+    {
+      Exec executor{ capacity };
+      REQUIRE( size_t( accounting::totals().live() - live ) >= capacity * capacity * sizeof( interconnect::Buffer ) );
+
+      accounting::Scope scope;
+      rabid::detail::Join join{ ssize_t( tasks ) };
+      executor.inject( 0, [&join]{
+          for( size_t index = 0; index < tasks; ++index )
+          {
+            Exec::async( index % Exec::concurrency(), [&join]{ join.notify(); } );
+          }
+        });
+      join.wait();
+
+      THEN( "tasks should be counted per worker within budget" )
+      {
+        // Idle workers also allocate wake sentinels, so only bound below.
+        //
+        const auto delta = scope.delta( accounting::Kind::task );
+        REQUIRE( delta.allocations >= tasks + 1 );
+        REQUIRE( delta.allocated <= delta.allocations * 256 );
+        REQUIRE( executor.ledger( 0 ).counts( accounting::Kind::task ).allocations >= tasks );
+      }
+    }
+
+    THEN( "buffers should be released with the executor" )
+    {
+      REQUIRE( accounting::totals().live() == live );
+    }
+  }
+}
+
+SCENARIO( "scopes should measure a single worker's ledger" )
+{
+  GIVEN( "an executor with scopes and splits run on worker 1" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 2;
+    accounting::Scope process;
+    Exec executor{ capacity };
+    REQUIRE( process.delta( accounting::Kind::stats ).allocations == capacity );
+
+    accounting::Scope scope{ executor.ledger( 1 ) };
+    rabid::detail::Join join{ 1 };
+    executor.inject( 1, [&join]
+      {
+        {
+          Exec::Scope tasks;
+          tasks.spawn( 1, []{} );
+        }
+        Exec::split( 0, 1000, 10, []( size_t, size_t ){}, [&join]{ join.notify(); } );
+      });
+    Promise<int> promise;
+    join.wait();
+
+    THEN( "only worker 1's allocations should be counted" )
+    {
+      REQUIRE( scope.delta( accounting::Kind::arena ).allocations == 1 );
+      REQUIRE( scope.delta( accounting::Kind::range ).allocations == 1 );
+      REQUIRE( scope.delta( accounting::Kind::promise ).allocations == 0 );
+      REQUIRE( scope.peak() >= 64 * 1024 );
+    }
+  }
+}
@@ -0,0 +1,107 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <checkpoint.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace rabid;
+
+namespace {
+
+  /// Path in the temporary directory, removed when it goes out of scope.
+  ///
+  struct Temporary {
+    const std::string path;
+
+    Temporary( const std::string & name )
+    : path( std::string{ std::getenv( "TMPDIR" ) ? std::getenv( "TMPDIR" ) : "/tmp" } + "/" + name + "." + std::to_string( ::getpid() ) )
+    {}
+
+    ~Temporary() { std::remove( path.c_str() ); }
+  };
+}
+
+SCENARIO( "checkpoints should restore worker-owned state" )
+{
+  GIVEN( "workers with shards of different sizes" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    const Temporary file{ "unit_test_checkpoint" };
+    const auto & path = file.path;
+    Exec executor{ capacity };
+
+    struct Shard {
+      std::string name;
+      std::vector<std::uint64_t> values;
+    };
+    std::vector<Shard> shards( capacity );
+    for( size_t index = 0; index < capacity; ++index )
+    {
+      shards[ index ].name = "shard " + std::to_string( index );
+      for( size_t value = 0; value < index * 1000; ++value )
+      {
+        shards[ index ].values.push_back( value * value + index );
+      }
+    }
+    const auto expected = shards;
+
+    REQUIRE( checkpoint::save( executor, path, [&shards]( checkpoint::Writer & writer )
+      {
+        const auto & shard = shards[ Exec::current() ];
+        writer.write( shard.name );
+        writer.write( shard.values );
+      }) );
+
+    WHEN( "restored into cleared shards" )
+    {
+      shards.assign( capacity, Shard{} );
+      std::vector<size_t> owners( capacity, capacity );
+      const bool restored = checkpoint::restore( executor, path, [&]( checkpoint::Reader & reader )
+        {
+          auto & shard = shards[ Exec::current() ];
+          reader.read( shard.name );
+          reader.read( shard.values );
+          owners[ Exec::current() ] = Exec::current();
+        });
+
+      THEN( "each worker should load its own segment" )
+      {
+        REQUIRE( restored );
+        for( size_t index = 0; index < capacity; ++index )
+        {
+          REQUIRE( owners[ index ] == index );
+          REQUIRE( shards[ index ].name == expected[ index ].name );
+          REQUIRE( shards[ index ].values == expected[ index ].values );
+        }
+      }
+    }
+
+    WHEN( "a reader runs past its segment" )
+    {
+      const bool restored = checkpoint::restore( executor, path, []( checkpoint::Reader & reader )
+        {
+          std::string name;
+          reader.read( name );
+          reader.view( reader.remaining() + 1 );
+        });
+
+      THEN( "restore should fail" )
+      {
+        REQUIRE_FALSE( restored );
+      }
+    }
+
+    WHEN( "restored into an executor of a different size" )
+    {
+      Exec other{ capacity + 1 };
+      const bool restored = checkpoint::restore( other, path, []( checkpoint::Reader & ){} );
+
+      THEN( "restore should fail" )
+      {
+        REQUIRE_FALSE( restored );
+      }
+    }
+  }
+}
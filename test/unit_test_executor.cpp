@@ -106,3 +106,455 @@ SCENARIO( "executor should run things in parallel" )
     }
   }
 }
+
+SCENARIO( "executor should sample queueing delay per connection" )
+{
+  GIVEN( "an executor sampling every message" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    Exec executor{ capacity, 1 };
+
+    THEN( "messages between workers should be recorded in the recipient's histograms" )
+    {
+      rabid::detail::Join join{ ssize_t(capacity) };
+
+      executor.inject( 0, [&join]{
+          for( size_t index = 0; index < Exec::concurrency(); ++index )
+          {
+            Exec::async( index, [&join]{ join.notify(); } );
+          }
+        });
+
+      join.wait();
+
+      size_t samples = 0;
+      for( size_t index = 0; index < capacity; ++index )
+      {
+        REQUIRE( executor.stats( index ).sampled() );
+        samples += executor.stats( index ).delay( 0 ).total();
+      }
+      REQUIRE( samples == capacity );
+    }
+  }
+}
+
+SCENARIO( "scoped tasks should fork and join within a task" )
+{
+  GIVEN( "an executor" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    Exec executor{ capacity };
+
+    struct Fibonacci {
+      static size_t evaluate( size_t n )
+      {
+        if( n < 2 )
+        {
+          return n;
+        }
+
+        size_t a = 0;
+        size_t b = 0;
+        {
+          Exec::Scope scope;
+          scope.spawn( ( Exec::current() + 1 ) % Exec::concurrency(), [&a,n]{ a = evaluate( n - 1 ); } );
+          scope.spawn( Exec::current(), [&b,n]{ b = evaluate( n - 2 ); } );
+          scope.join();
+        }
+        return a + b;
+      }
+    };
+
+    THEN( "recursive decomposition should produce the sequential result" )
+    {
+      rabid::detail::Join join{ 1 };
+      size_t result = 0;
+
+      executor.inject( 0, [&]{
+          result = Fibonacci::evaluate( 16 );
+          join.notify();
+        });
+
+      join.wait();
+      REQUIRE( result == 987 );
+    }
+  }
+}
+
+SCENARIO( "a task should still defer after joining a scope" )
+{
+  GIVEN( "a task whose scoped functor runs inside its join" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 2;
+    Exec executor{ capacity };
+
+    std::vector<size_t> ran;
+    rabid::detail::Join done{ 1 };
+    executor.inject( 0, [&]
+      {
+        ran.push_back( Exec::current() );
+        if( ran.size() == 1 )
+        {
+          {
+            Exec::Scope scope;
+            scope.spawn( Exec::current(), [&]{ ran.push_back( Exec::current() ); } );
+            scope.join();
+          }
+          Exec::defer( size_t{ 1 } );
+        }
+        else
+        {
+          done.notify();
+        }
+      });
+    done.wait();
+
+    THEN( "the task itself should be re-evaluated on the deferred worker" )
+    {
+      REQUIRE( ran == std::vector<size_t>{ 0, 0, 1 } );
+    }
+  }
+}
+
+SCENARIO( "each should wait for every worker and the work it counts" )
+{
+  GIVEN( "an executor" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    Exec executor{ capacity };
+    std::vector<size_t> ran( capacity, 0 );
+    std::vector<size_t> received( capacity, 0 );
+
+    WHEN( "each worker sends a counted task to its neighbor" )
+    {
+      rabid::detail::Counter counter{ 0 };
+      executor.each( counter, [&]( size_t index )
+        {
+          ran[ index ] = Exec::current() + 1;
+          counter.increment();
+          Exec::async( ( index + 1 ) % capacity, [&]
+            {
+              received[ Exec::current() ] += 1;
+              counter.decrement();
+            });
+        });
+
+      THEN( "every worker should have run the function and received one task" )
+      {
+        REQUIRE( ran == std::vector<size_t>{ 1, 2, 3, 4 } );
+        REQUIRE( received == std::vector<size_t>( capacity, 1 ) );
+      }
+    }
+  }
+}
+
+SCENARIO( "split ranges should cover every item exactly once" )
+{
+  GIVEN( "an executor" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    Exec executor{ capacity };
+
+    THEN( "every item should be visited once before done, across workers" )
+    {
+      const size_t size = 100000;
+      std::vector<size_t> visits( size, 0 );
+      std::vector<std::atomic<size_t>> pieces( capacity );
+      rabid::detail::Join join{ 1 };
+
+      // Let the other workers park, so they are idle when the range starts.
+      //
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      executor.inject( 0, [&]{
+          Exec::split( 0, size, 64, [&]( size_t begin, size_t end )
+            {
+              pieces[ Exec::current() ] += 1;
+              for( size_t index = begin; index < end; ++index )
+              {
+                visits[ index ] += 1;
+              }
+            },
+            [&]{ join.notify(); } );
+        });
+
+      join.wait();
+      REQUIRE( std::count( visits.begin(), visits.end(), 1 ) == ssize_t( size ) );
+      REQUIRE( std::count_if( pieces.begin(), pieces.end(), []( const std::atomic<size_t> & count ){ return count.load() > 0; } ) > 1 );
+    }
+  }
+}
+
+SCENARIO( "background work should run in slices while the worker is idle" )
+{
+  GIVEN( "an executor" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 2;
+    Exec executor{ capacity };
+
+    THEN( "finite background work should run to completion" )
+    {
+      const size_t slices = 1000;
+      size_t ran = 0;
+      rabid::detail::Join join{ 1 };
+
+      executor.inject( 1, [&]{
+          Exec::background( [&]
+            {
+              ran += 1;
+              if( ran == slices )
+              {
+                join.notify();
+              }
+              return ran < slices;
+            });
+        });
+
+      join.wait();
+      REQUIRE( ran == slices );
+    }
+
+    THEN( "messages should be evaluated between slices of unfinished work" )
+    {
+      std::atomic<bool> stop{ false };
+      std::atomic<size_t> ran{ 0 };
+      size_t messages = 0;
+      rabid::detail::Join started{ 1 };
+      rabid::detail::Join stopped{ 1 };
+
+      executor.inject( 1, [&]{
+          Exec::background( [&]
+            {
+              if( ran.fetch_add( 1 ) == 0 )
+              {
+                started.notify();
+              }
+              if( stop )
+              {
+                stopped.notify();
+              }
+              return !stop;
+            });
+        });
+      started.wait();
+
+      rabid::detail::Join delivered{ 1 };
+      executor.inject( 0, [&]{
+          for( size_t index = 0; index < 100; ++index )
+          {
+            Exec::async( 1, [&]
+              {
+                if( ++messages == 100 )
+                {
+                  delivered.notify();
+                }
+              });
+          }
+        });
+      delivered.wait();
+      stop = true;
+      stopped.wait();
+
+      REQUIRE( messages == 100 );
+      REQUIRE( ran > 1 );
+    }
+  }
+}
+
+SCENARIO( "checkpoints should let messages through a long task" )
+{
+  GIVEN( "a task waiting on a message sent to its own worker" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 2;
+    Exec executor{ capacity };
+
+    std::atomic<bool> flag{ false };
+    std::atomic<bool> started{ false };
+    size_t nested = 1;
+    size_t deferred = 0;
+    rabid::detail::Join done{ 2 };
+
+    executor.inject( 1, [&]
+      {
+        started = true;
+        while( !flag )
+        {
+          Exec::checkpoint();
+        }
+        done.notify();
+      });
+    executor.inject( 0, [&]
+      {
+        while( !started ) {}
+        Exec::async( 1, [&]
+          {
+            flag = true;
+            nested = Exec::checkpoint();
+          })
+          .then( [&]
+          {
+            deferred = Exec::current();
+            done.notify();
+          });
+      });
+    done.wait();
+
+    THEN( "the message should run inside the task without nesting further" )
+    {
+      REQUIRE( flag );
+      REQUIRE( nested == 0 );
+      REQUIRE( deferred == 1 );
+    }
+  }
+}
+
+SCENARIO( "checkpoints should run inside a scope's join" )
+{
+  GIVEN( "a scoped task that queues a message to its own worker" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 2;
+    Exec executor{ capacity };
+
+    size_t nested = 0;
+    rabid::detail::Counter done{ 2 };
+
+    executor.inject( 1, [&]
+      {
+        {
+          Exec::Scope scope;
+          scope.spawn( Exec::current(), [&]
+            {
+              Exec::async( Exec::current(), [&]{ done.decrement(); } );
+              nested = Exec::checkpoint();
+            });
+          scope.join();
+        }
+        done.decrement();
+      });
+    done.wait();
+
+    THEN( "the checkpoint should run the message" )
+    {
+      REQUIRE( nested == 1 );
+    }
+  }
+}
+
+SCENARIO( "checkpoints should stop under deeply nested joins" )
+{
+  GIVEN( "a checkpoint reached through nested scopes on one worker" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 2;
+    Exec executor{ capacity };
+
+    struct Nest {
+      static size_t evaluate( size_t levels, rabid::detail::Counter & done )
+      {
+        if( levels == 0 )
+        {
+          Exec::async( Exec::current(), [&done]{ done.decrement(); } );
+          return Exec::checkpoint();
+        }
+        size_t nested = 0;
+        Exec::Scope scope;
+        scope.spawn( Exec::current(), [&]{ nested = evaluate( levels - 1, done ); } );
+        scope.join();
+        return nested;
+      }
+    };
+
+    const auto run = [&executor]( size_t levels )
+    {
+      size_t nested = 0;
+      rabid::detail::Counter done{ 2 };
+      executor.inject( 1, [&]
+        {
+          nested = Nest::evaluate( levels, done );
+          done.decrement();
+        });
+      done.wait();
+      return nested;
+    };
+
+    // Checkpoints run under at most 8 nested joins.
+    //
+    THEN( "checkpoints should run up to the join limit and stop past it" )
+    {
+      REQUIRE( run( 8 ) == 1 );
+      REQUIRE( run( 9 ) == 0 );
+    }
+  }
+}
+
+SCENARIO( "endless background work should not keep a worker spinning" )
+{
+  GIVEN( "an executor with a background function that never finishes" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    std::atomic<size_t> ran{ 0 };
+    rabid::detail::Join started{ 1 };
+    {
+      Exec executor{ 2 };
+      executor.inject( 1, [&]{
+          Exec::background( [&]
+            {
+              if( ran.fetch_add( 1 ) == 0 )
+              {
+                started.notify();
+              }
+              return true;
+            });
+        });
+      started.wait();
+
+      WHEN( "the worker has been idle for a while" )
+      {
+        const auto before = ran.load();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+
+        // Unbounded slicing would run millions of slices in this time.
+        //
+        THEN( "slices should have run in bounded bursts between pauses" )
+        {
+          REQUIRE( ran.load() > before );
+          REQUIRE( ran.load() - before < 64 * 1000 );
+        }
+      }
+    }
+
+    THEN( "the executor should have been destroyed" )
+    {
+      REQUIRE( ran.load() > 0 );
+    }
+  }
+}
+
+SCENARIO( "disabling a sleeping worker should tell it to exit" )
+{
+  GIVEN( "a worker asleep in yield()" )
+  {
+    rabid::detail::idle::Wait idle;
+    bool result = true;
+    std::thread thread{ [&]{ result = idle.yield(); } };
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+    WHEN( "it is disabled" )
+    {
+      idle.enable( false );
+      thread.join();
+
+      THEN( "the woken yield should report that the worker must stop" )
+      {
+        REQUIRE( !result );
+      }
+    }
+  }
+}
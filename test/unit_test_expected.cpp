@@ -0,0 +1,136 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <future.h>
+#include <expected.h>
+
+using namespace rabid;
+
+namespace {
+
+  enum class Error { parse, range };
+
+  Expected<int,Error> parse( int value )
+  {
+    if( value < 0 )
+    {
+      return unexpected( Error::parse );
+    }
+    return value;
+  }
+}
+
+// Chains without Expected keep their original result types.
+//
+static_assert( std::is_same<detail::continued_t<int(*)( int & ),int>, int>::value, "plain continuations must not be wrapped" );
+static_assert( std::is_same<detail::continued_t<int(*)( int & ),Expected<int,Error>>, Expected<int,Error>>::value, "values continue as Expected" );
+static_assert( std::is_same<detail::continued_t<Expected<long,Error>(*)( int & ),Expected<int,Error>>, Expected<long,Error>>::value, "Expected results do not nest" );
+static_assert( std::is_same<detail::continued_t<void(*)( int & ),Expected<int,Error>>, Expected<void,Error>>::value, "void continues as Expected<void>" );
+
+SCENARIO( "errors should propagate down future chains" )
+{
+  GIVEN( "a promise of an Expected value" )
+  {
+    Promise<Expected<int,Error>> promise;
+    size_t successes = 0;
+    size_t handled = 0;
+    int result = 0;
+    Error seen = Error::range;
+
+    promise.then( [&successes]( int & value ){ successes += 1; return value * 2; } )
+      .then( [&successes]( int & value ){ successes += 1; return parse( value - 10 ); } )
+      .then( [&successes]( int & value ){ successes += 1; return value + 1; } )
+      .on_error( [&handled,&seen]( Error & error ){ handled += 1; seen = error; return -1; } )
+      .then( [&result]( int & value ){ result = value; } );
+
+    WHEN( "the promise completes with a value" )
+    {
+      promise.complete( 21 );
+
+      THEN( "every success stage should run and the handler should not" )
+      {
+        REQUIRE( successes == 3 );
+        REQUIRE( handled == 0 );
+        REQUIRE( result == 33 );
+      }
+    }
+
+    WHEN( "a stage in the middle fails" )
+    {
+      promise.complete( 2 );
+
+      THEN( "later success stages should be skipped until the handler recovers" )
+      {
+        REQUIRE( successes == 2 );
+        REQUIRE( handled == 1 );
+        REQUIRE( seen == Error::parse );
+        REQUIRE( result == -1 );
+      }
+    }
+
+    WHEN( "the promise completes with an error" )
+    {
+      promise.complete( unexpected( Error::range ) );
+
+      THEN( "no success stage should run before the handler" )
+      {
+        REQUIRE( successes == 0 );
+        REQUIRE( handled == 1 );
+        REQUIRE( seen == Error::range );
+        REQUIRE( result == -1 );
+      }
+    }
+  }
+
+  GIVEN( "a handler that only observes errors" )
+  {
+    Promise<Expected<void,Error>> promise;
+    size_t observed = 0;
+    bool failed = false;
+
+    promise.on_error( [&observed]( Error & ){ observed += 1; } )
+      .then( [&failed]( Expected<void,Error> & expected ){ failed = !expected; } );
+    promise.complete( unexpected( Error::range ) );
+
+    THEN( "the error should continue past it" )
+    {
+      REQUIRE( observed == 1 );
+      REQUIRE( failed );
+    }
+  }
+}
+
+SCENARIO( "executor tasks should carry errors across workers" )
+{
+  GIVEN( "an executor" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    Exec executor{ capacity };
+
+    const size_t tasks = 64;
+    std::atomic<size_t> successes{ 0 };
+    std::atomic<size_t> failures{ 0 };
+    std::atomic<size_t> skipped{ 0 };
+    rabid::detail::Join join{ ssize_t( tasks ) };
+
+    executor.inject( 0, [&]
+      {
+        for( size_t index = 0; index < tasks; ++index )
+        {
+          const auto value = ( index % 4 == 0 ? -1 : int( index ) );
+          Exec::async( index % capacity, [value]{ return parse( value ); } )
+            .then( ( index + 1 ) % capacity, [&skipped]( int & parsed ){ skipped += ( parsed < 0 ); return parsed; } )
+            .on_error( ( index + 2 ) % capacity, [&failures]( Error & ){ failures += 1; return 0; } )
+            .then( ( index + 3 ) % capacity, [&successes,&join]( int & parsed ){ successes += ( parsed > 0 ); join.notify(); } );
+        }
+      });
+    join.wait();
+
+    THEN( "each task should either succeed or be handled once" )
+    {
+      REQUIRE( skipped == 0 );
+      REQUIRE( failures == tasks / 4 );
+      REQUIRE( successes == tasks - tasks / 4 );
+    }
+  }
+}
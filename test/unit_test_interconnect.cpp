@@ -0,0 +1,145 @@
+#include <catch.hpp>
+#include <interconnect.h>
+
+#include <numeric>
+#include <thread>
+
+using namespace rabid;
+
+namespace {
+
+  /// Unidirectional ring: connection 0 is loopback, connection 1 links a
+  /// node's outbound messages to its successor.
+  ///
+  class Ring {
+   public:
+    Ring( size_t self_arg ) : self( self_arg ) {}
+
+    size_t operator()( size_t address ) const { return address == self ? 0 : 1; }
+    bool terminal( const interconnect::Message::PointerType & message ) const { return message->address == self; }
+
+   protected:
+    size_t self;
+  };
+
+  struct Agent {
+    std::vector<size_t> delivered;
+    size_t batches = 0;
+
+    TaggedPointer<interconnect::Message> sentinel() const { return TaggedPointer<interconnect::Message>{ nullptr }; }
+
+    auto preparer()
+    {
+      batches += 1;
+      return []( const interconnect::Message::PointerType & prior ){ return prior; };
+    }
+
+    void receive( const interconnect::Message::PointerType & message, size_t )
+    {
+      delivered[ message->address ] += 1;
+    }
+  };
+}
+
+SCENARIO( "nodes should forward messages in batches per next hop" )
+{
+  GIVEN( "a ring of nodes with messages queued for the farthest one" )
+  {
+    const size_t count = 4;
+    const size_t messages = 100;
+    const auto buffers = std::make_unique<interconnect::Buffer[]>( count * 2 );
+
+    std::vector<interconnect::Node<Ring>> nodes;
+    for( size_t index = 0; index < count; ++index )
+    {
+      const auto next = ( index + 1 ) % count;
+      std::vector<interconnect::Connection> connections;
+      connections.emplace_back( buffers[ index * 2 ], buffers[ index * 2 ] );
+      connections.emplace_back( buffers[ next * 2 + 1 ], buffers[ index * 2 + 1 ] );
+      nodes.emplace_back( std::move( connections ), index );
+    }
+
+    std::vector<interconnect::Message> pool;
+    pool.reserve( messages );
+    for( size_t index = 0; index < messages; ++index )
+    {
+      pool.emplace_back( ( index % 2 ) ? count - 1 : 0 );
+      nodes[ 0 ].send( interconnect::Message::PointerType{ &pool.back() }, []( const interconnect::Message::PointerType & prior ){ return prior; } );
+    }
+
+    WHEN( "each node operates once in ring order" )
+    {
+      Agent agent{ std::vector<size_t>( count, 0 ) };
+      for( auto & node : nodes )
+      {
+        node.operate( agent );
+      }
+
+      // Sending from node 0 covers the first hop; the rest are forwarded.
+      //
+      THEN( "every message should arrive with one splice per forwarded hop" )
+      {
+        REQUIRE( agent.delivered[ 0 ] == messages / 2 );
+        REQUIRE( agent.delivered[ count - 1 ] == messages / 2 );
+        REQUIRE( agent.batches == count - 2 );
+      }
+
+      THEN( "only nodes that forwarded should hold forwarding groups" )
+      {
+        const auto bare = 2 * sizeof( interconnect::Connection );
+        REQUIRE( nodes[ 0 ].footprint() == bare );
+        REQUIRE( nodes[ 1 ].footprint() > bare );
+        REQUIRE( nodes[ count - 1 ].footprint() == bare );
+      }
+    }
+  }
+}
+
+SCENARIO( "combining senders should deliver every deposit" )
+{
+  GIVEN( "threads sending through a combining buffer" )
+  {
+    const size_t senders = 4;
+    const size_t messages = 10000;
+    interconnect::Buffer destination;
+    interconnect::Combining combining{ destination, senders };
+
+    std::vector<std::vector<interconnect::Message>> pools( senders );
+    std::vector<std::thread> threads;
+    for( size_t sender = 0; sender < senders; ++sender )
+    {
+      pools[ sender ].assign( messages, interconnect::Message{ sender } );
+      threads.emplace_back( [&combining,&pools,sender]
+        {
+          for( auto & message : pools[ sender ] )
+          {
+            combining.send( sender, interconnect::Message::PointerType{ &message }, []( const interconnect::Message::PointerType & prior ){ return prior; } );
+          }
+        });
+    }
+
+    std::vector<size_t> received( senders, 0 );
+    const auto drain = [&destination,&received]
+    {
+      auto batch = destination.clear();
+      while( !batch.empty() )
+      {
+        received[ batch.remove()->address ] += 1;
+      }
+    };
+    while( std::accumulate( received.begin(), received.end(), size_t( 0 ) ) < senders * messages / 2 )
+    {
+      drain();
+    }
+    for( auto & thread : threads )
+    {
+      thread.join();
+    }
+    drain();
+
+    THEN( "nothing should be left in a slot once senders return" )
+    {
+      REQUIRE( received == std::vector<size_t>( senders, messages ) );
+    }
+  }
+}
@@ -0,0 +1,121 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <ordered.h>
+
+#include <map>
+
+using namespace rabid;
+
+SCENARIO( "range-partitioned maps should scan in key order" )
+{
+  GIVEN( "a map loaded with keys split by sampled quantiles" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    using Map = ordered::Map<Exec,size_t,size_t>;
+    const size_t capacity = 4;
+    Exec executor{ capacity };
+
+    std::vector<Map::Entry> entries;
+    std::vector<size_t> sample;
+    std::map<size_t,size_t> expected;
+    for( size_t index = 0; index < 20000; ++index )
+    {
+      const auto key = ( index * 7919 ) % 100003;
+      entries.emplace_back( key, index );
+      expected[ key ] = index;
+      if( index % 100 == 0 )
+      {
+        sample.push_back( key );
+      }
+    }
+
+    Map map{ capacity, ordered::splitters( sample, capacity ) };
+    map.load( executor, entries );
+
+    THEN( "owners should hold similar shares of the keys" )
+    {
+      std::vector<size_t> owned( capacity, 0 );
+      for( auto & entry : expected )
+      {
+        owned[ map.owner( entry.first ) ] += 1;
+      }
+      for( auto count : owned )
+      {
+        REQUIRE( count > expected.size() / capacity / 2 );
+      }
+    }
+
+    WHEN( "ranges are scanned and keys updated from a worker" )
+    {
+      const std::vector<std::pair<size_t,size_t>> ranges = { { 0, 100003 }, { 5000, 5100 }, { 42, 42 }, { 30000, 70000 } };
+      std::vector<std::vector<Map::Entry>> results( ranges.size() );
+      size_t found = 0;
+      bool missing = false;
+      rabid::detail::Join join{ ssize_t( ranges.size() + 2 ) };
+
+      executor.wake();
+      executor.inject( 1, [&]
+        {
+          for( size_t index = 0; index < ranges.size(); ++index )
+          {
+            map.scan( ranges[ index ].first, ranges[ index ].second, [&results,&join,index]( std::vector<Map::Entry> & result )
+              {
+                results[ index ] = std::move( result );
+                join.notify();
+              });
+          }
+          map.find( expected.begin()->first, [&found,&join]( const size_t * value )
+            {
+              found = ( value ? *value : 0 );
+              join.notify();
+            });
+          map.find( 100003, [&missing,&join]( const size_t * value )
+            {
+              missing = ( value == nullptr );
+              join.notify();
+            });
+        });
+      join.wait();
+
+      THEN( "each scan should match the ordered reference" )
+      {
+        for( size_t index = 0; index < ranges.size(); ++index )
+        {
+          const std::vector<Map::Entry> reference{ expected.lower_bound( ranges[ index ].first ), expected.lower_bound( ranges[ index ].second ) };
+          REQUIRE( results[ index ] == reference );
+        }
+        REQUIRE( found == expected.begin()->second );
+        REQUIRE( missing );
+      }
+    }
+
+    WHEN( "entries are replaced by a second load" )
+    {
+      std::vector<Map::Entry> updates;
+      for( size_t key = 0; key < 100003; key += 1000 )
+      {
+        updates.emplace_back( key, 0 );
+        expected[ key ] = 0;
+      }
+      map.load( executor, updates );
+
+      std::vector<Map::Entry> result;
+      rabid::detail::Join join{ 1 };
+      executor.wake();
+      executor.inject( 0, [&]
+        {
+          map.scan( 0, 100003, [&result,&join]( std::vector<Map::Entry> & scanned )
+            {
+              result = std::move( scanned );
+              join.notify();
+            });
+        });
+      join.wait();
+
+      THEN( "later values should win" )
+      {
+        REQUIRE( result == std::vector<Map::Entry>{ expected.begin(), expected.end() } );
+      }
+    }
+  }
+}
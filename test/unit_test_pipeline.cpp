@@ -0,0 +1,99 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <pipeline.h>
+
+#include <map>
+#include <string>
+
+using namespace rabid;
+
+SCENARIO( "pipelines should match sequential evaluation" )
+{
+  GIVEN( "an executor and a range of items" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    Exec executor{ capacity };
+
+    std::vector<size_t> items;
+    for( size_t item = 0; item < 10000; ++item )
+    {
+      items.push_back( item );
+    }
+
+    WHEN( "fused stages are collected" )
+    {
+      auto squares = pipeline::parallel( items, 64 )
+        | pipeline::filter( []( size_t item ){ return item % 3 == 0; } )
+        | pipeline::transform( []( size_t item ){ return item * item; } )
+        | pipeline::flat_map<size_t>( []( size_t item, auto && emit ){ emit( item ); emit( item + 1 ); } );
+      auto result = squares.collect( executor );
+      std::sort( result.begin(), result.end() );
+
+      THEN( "every element should be produced once" )
+      {
+        std::vector<size_t> expected;
+        for( auto item : items )
+        {
+          if( item % 3 == 0 )
+          {
+            expected.push_back( item * item );
+            expected.push_back( item * item + 1 );
+          }
+        }
+        REQUIRE( result == expected );
+      }
+    }
+
+    WHEN( "elements are grouped twice" )
+    {
+      // Sum by residue mod 100, then count residues by the parity of their sum.
+      //
+      auto sums = pipeline::parallel( items, 16 )
+        | pipeline::group_by( []( size_t item ){ return item % 100; }, size_t( 0 ), []( size_t & sum, size_t item ){ sum += item; }, 7 );
+      auto parity = std::move( sums )
+        | pipeline::transform( []( const std::pair<const size_t,size_t> & group ){ return group.second % 2; } )
+        | pipeline::group_by( []( size_t bit ){ return bit; }, size_t( 0 ), []( size_t & count, size_t ){ count += 1; }, 1 );
+
+      auto result = parity.collect( executor );
+      std::map<size_t,size_t> counts{ result.begin(), result.end() };
+
+      THEN( "the second grouping should see the first's results" )
+      {
+        std::map<size_t,size_t> sequential;
+        for( auto item : items )
+        {
+          sequential[ item % 100 ] += item;
+        }
+        std::map<size_t,size_t> expected;
+        for( auto & group : sequential )
+        {
+          expected[ group.second % 2 ] += 1;
+        }
+        REQUIRE( counts == expected );
+      }
+    }
+
+    WHEN( "groups are folded on their owners" )
+    {
+      std::vector<size_t> owners( 10, capacity );
+      auto groups = pipeline::parallel( items, 256 )
+        | pipeline::group_by( []( size_t item ){ return item % 10; }, std::string{}, []( std::string & digits, size_t item ){ digits += char( '0' + item % 10 ); } );
+      groups.for_each( executor, [&owners]( const std::pair<const size_t,std::string> & group )
+        {
+          if( group.second.size() == 1000 && group.second.find_first_not_of( char( '0' + group.first ) ) == std::string::npos )
+          {
+            owners[ group.first ] = Exec::current();
+          }
+        });
+
+      THEN( "each key should be owned by the worker its hash selects" )
+      {
+        for( size_t key = 0; key < owners.size(); ++key )
+        {
+          REQUIRE( owners[ key ] == std::hash<size_t>{}( key ) % capacity );
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,118 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <placement.h>
+
+using namespace rabid;
+
+SCENARIO( "workers should record their traffic rows" )
+{
+  GIVEN( "an executor where worker 0 sends to worker 2" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 4;
+    const size_t messages = 100;
+    Exec executor{ capacity };
+
+    rabid::detail::Counter counter{ messages };
+    executor.inject( 0, [&counter]
+      {
+        for( size_t index = 0; index < messages; ++index )
+        {
+          Exec::async( 2, [&counter]{ counter.decrement(); } );
+        }
+      });
+    counter.wait();
+
+    THEN( "the matrix should hold the messages in row 0" )
+    {
+      const auto matrix = placement::traffic( executor );
+      REQUIRE( matrix[ 0 ][ 2 ] == messages );
+      REQUIRE( matrix[ 2 ][ 0 ] == 0 );
+      REQUIRE( matrix[ 1 ][ 3 ] == 0 );
+    }
+  }
+}
+
+SCENARIO( "placement should keep heavy communicators on one socket" )
+{
+  GIVEN( "two sockets of two cores, and pairs split across them by index" )
+  {
+    const std::vector<placement::Core> cores = {
+      { 0, 0, 0, 0 },
+      { 1, 0, 0, 1 },
+      { 2, 1, 2, 2 },
+      { 3, 1, 2, 3 } };
+
+    // Workers 0 and 2 talk, as do 1 and 3.
+    //
+    placement::Matrix traffic( 4, std::vector<size_t>( 4, 1 ) );
+    traffic[ 0 ][ 2 ] = traffic[ 2 ][ 0 ] = 1000;
+    traffic[ 1 ][ 3 ] = traffic[ 3 ][ 1 ] = 500;
+
+    const auto before = placement::linear( 4, cores );
+    const auto after = placement::optimize( traffic, cores );
+
+    THEN( "each pair should share a socket and cross-socket traffic should drop" )
+    {
+      REQUIRE( cores[ after[ 0 ] ].package == cores[ after[ 2 ] ].package );
+      REQUIRE( cores[ after[ 1 ] ].package == cores[ after[ 3 ] ].package );
+      REQUIRE( placement::cross_socket( traffic, cores, before ) > 0.9 );
+      REQUIRE( placement::cross_socket( traffic, cores, after ) < 0.01 );
+
+      auto sorted = after;
+      std::sort( sorted.begin(), sorted.end() );
+      REQUIRE( sorted == before );
+    }
+  }
+}
+
+#ifdef __linux__
+SCENARIO( "applying a placement should pin workers to their cores" )
+{
+  GIVEN( "an executor and the cores this process may run on" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 2;
+    Exec executor{ capacity };
+    const auto cores = placement::topology();
+    REQUIRE( !cores.empty() );
+
+    WHEN( "every worker is placed on the last allowed core" )
+    {
+      const std::vector<size_t> placed( capacity, cores.size() - 1 );
+      const bool pinned = placement::apply( executor, cores, placed );
+
+      THEN( "each worker's affinity should read back as that core alone" )
+      {
+        REQUIRE( pinned );
+        std::vector<cpu_set_t> sets( capacity );
+        executor.each( [&sets]( size_t index )
+          {
+            CPU_ZERO( &sets[ index ] );
+            sched_getaffinity( 0, sizeof( cpu_set_t ), &sets[ index ] );
+          });
+        for( auto & set : sets )
+        {
+          REQUIRE( CPU_COUNT( &set ) == 1 );
+          REQUIRE( CPU_ISSET( cores.back().cpu, &set ) );
+        }
+
+        // Pins carry over to later executors; leave the next test unpinned.
+        //
+        for( size_t index = 0; index < capacity; ++index )
+        {
+          REQUIRE( executor.unpin( index ) );
+        }
+      }
+    }
+
+    WHEN( "a worker is pinned beyond the cpu set" )
+    {
+      THEN( "pinning should fail" )
+      {
+        REQUIRE( !executor.pin( 0, CPU_SETSIZE ) );
+      }
+    }
+  }
+}
+#endif
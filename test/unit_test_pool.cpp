@@ -0,0 +1,123 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <pool.h>
+
+using namespace rabid;
+
+namespace {
+
+  struct Request {
+    static std::atomic<size_t> constructed;
+    static std::atomic<size_t> destroyed;
+
+    Request( size_t id_arg ) : id( id_arg ) { constructed += 1; }
+    ~Request() { destroyed += 1; }
+
+    size_t id;
+    std::vector<size_t> scratch;
+  };
+
+  std::atomic<size_t> Request::constructed{ 0 };
+  std::atomic<size_t> Request::destroyed{ 0 };
+
+  struct Clear {
+    void operator()( Request & request ) const { request.scratch.clear(); }
+  };
+}
+
+SCENARIO( "pools should recycle objects on their home worker" )
+{
+  using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+  const size_t capacity = 3;
+  Request::constructed = 0;
+  Request::destroyed = 0;
+
+  GIVEN( "a destroying pool used on one worker" )
+  {
+    Exec executor{ capacity };
+    Pool<Exec,Request> pool{ capacity, 4, 8 };
+    bool reused = false;
+    size_t allocated = 0;
+    rabid::detail::Join join{ 1 };
+
+    executor.inject( 0, [&]
+      {
+        const Request * first = nullptr;
+        for( size_t index = 0; index < 100; ++index )
+        {
+          auto request = pool.acquire( index );
+          first = ( first ? first : request.get() );
+          reused = ( request.get() == first && request->id == index );
+        }
+        allocated = pool.capacity( 0 );
+        join.notify();
+      });
+    join.wait();
+
+    THEN( "one slot should be reused, constructing each time" )
+    {
+      REQUIRE( reused );
+      REQUIRE( allocated == 8 );
+      REQUIRE( Request::constructed == 100 );
+      REQUIRE( Request::destroyed == 100 );
+    }
+  }
+
+  GIVEN( "a resetting pool whose objects are released on other workers" )
+  {
+    const size_t objects = 10;
+    {
+      Exec executor{ capacity };
+      Pool<Exec,Request,Clear> pool{ capacity, 4, 8 };
+
+      auto run = [&executor]( size_t index, std::function<void()> function )
+      {
+        rabid::detail::Join join{ 1 };
+        executor.inject( index, [&]{ function(); join.notify(); } );
+        join.wait();
+      };
+
+      std::vector<Pool<Exec,Request,Clear>::Pointer> requests;
+      run( 0, [&]
+        {
+          for( size_t index = 0; index < objects; ++index )
+          {
+            requests.push_back( pool.acquire( index ) );
+            requests.back()->scratch.assign( 16, index );
+          }
+        });
+      run( 1, [&]{ requests.clear(); pool.flush(); } );
+
+      size_t available = 0;
+      for( size_t attempt = 0; attempt < 1000 && available < pool.capacity( 0 ); ++attempt )
+      {
+        run( 0, [&]{ available = pool.available( 0 ); } );
+      }
+
+      THEN( "every object should return home reset but not destroyed" )
+      {
+        REQUIRE( available == 16 );
+        REQUIRE( Request::constructed == objects );
+        REQUIRE( Request::destroyed == 0 );
+
+        bool cleared = true;
+        run( 0, [&]
+          {
+            for( size_t index = 0; index < objects; ++index )
+            {
+              requests.push_back( pool.acquire( index ) );
+              cleared = cleared && requests.back()->scratch.empty();
+            }
+            requests.clear();
+          });
+        REQUIRE( cleared );
+        REQUIRE( Request::constructed == objects );
+      }
+    }
+
+    THEN( "objects should be destroyed with the pool" )
+    {
+      REQUIRE( Request::destroyed == Request::constructed );
+    }
+  }
+}
@@ -0,0 +1,145 @@
+#include <catch.hpp>
+#include <Executor.h>
+
+using namespace rabid;
+
+namespace {
+
+  using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+
+  /// Collect the thread id running each worker.
+  ///
+  std::vector<std::thread::id> identify( Exec & executor )
+  {
+    std::vector<std::thread::id> ids( executor.size() );
+    executor.each( [&ids]( size_t index ){ ids[ index ] = std::this_thread::get_id(); } );
+    return ids;
+  }
+}
+
+SCENARIO( "executors should borrow parked threads from the registry" )
+{
+  GIVEN( "an executor that has been destroyed" )
+  {
+    const size_t capacity = 3;
+    std::vector<std::thread::id> before;
+    {
+      Exec executor{ capacity };
+      before = identify( executor );
+    }
+    const auto spawned = execution::Registry::size();
+
+    WHEN( "another executor of the same size is created" )
+    {
+      Exec executor{ capacity };
+      const auto after = identify( executor );
+
+      THEN( "each worker should run on the thread it had before" )
+      {
+        REQUIRE( after == before );
+        REQUIRE( execution::Registry::size() == spawned );
+      }
+
+      THEN( "tasks should still run across workers" )
+      {
+        rabid::detail::Counter counter{ capacity * capacity };
+        for( size_t index = 0; index < capacity; ++index )
+        {
+          executor.inject( index, [&counter]
+            {
+              for( size_t target = 0; target < Exec::concurrency(); ++target )
+              {
+                Exec::async( target, [&counter]{ counter.decrement(); } );
+              }
+            });
+        }
+        counter.wait();
+      }
+    }
+  }
+}
+
+#ifdef __linux__
+SCENARIO( "pins should carry over to the same worker of later executors" )
+{
+  GIVEN( "an executor that pinned its first worker, then was destroyed" )
+  {
+    const size_t capacity = 2;
+    cpu_set_t before;
+    CPU_ZERO( &before );
+    sched_getaffinity( 0, sizeof( before ), &before );
+    size_t cpu = 0;
+    while( !CPU_ISSET( cpu, &before ) )
+    {
+      ++cpu;
+    }
+    {
+      Exec executor{ capacity };
+      REQUIRE( executor.pin( 0, cpu ) );
+    }
+
+    WHEN( "another executor starts without pinning" )
+    {
+      Exec executor{ capacity };
+      const auto read = [&executor]
+      {
+        std::vector<cpu_set_t> sets( executor.size() );
+        executor.each( [&sets]( size_t index )
+          {
+            CPU_ZERO( &sets[ index ] );
+            sched_getaffinity( 0, sizeof( cpu_set_t ), &sets[ index ] );
+          });
+        return sets;
+      };
+      const auto pinned = read();
+
+      THEN( "the first worker should still be pinned, and the other not" )
+      {
+        REQUIRE( CPU_COUNT( &pinned[ 0 ] ) == 1 );
+        REQUIRE( CPU_ISSET( cpu, &pinned[ 0 ] ) );
+        REQUIRE( CPU_EQUAL( &pinned[ 1 ], &before ) );
+      }
+
+      AND_WHEN( "the worker is unpinned" )
+      {
+        REQUIRE( executor.unpin( 0 ) );
+        const auto unpinned = read();
+
+        THEN( "it should have its default affinity back" )
+        {
+          REQUIRE( CPU_EQUAL( &unpinned[ 0 ], &before ) );
+        }
+      }
+    }
+  }
+}
+#endif
+
+SCENARIO( "interconnect buffers should be recycled empty" )
+{
+  GIVEN( "a pooled buffer array released with a message in it" )
+  {
+    const size_t count = 5;
+    interconnect::Message message{ 0 };
+    interconnect::Buffer * address = nullptr;
+    {
+      auto buffers = interconnect::Pool::acquire( count );
+      buffers[ count - 1 ].insert( interconnect::Message::PointerType{ &message }, []( const interconnect::Message::PointerType & prior ){ return prior; } );
+      address = buffers.get();
+    }
+
+    WHEN( "an array of the same size is acquired" )
+    {
+      auto buffers = interconnect::Pool::acquire( count );
+
+      THEN( "the same array should come back with every buffer empty" )
+      {
+        REQUIRE( buffers.get() == address );
+        for( size_t index = 0; index < count; ++index )
+        {
+          REQUIRE( buffers[ index ].peek() == nullptr );
+        }
+      }
+    }
+  }
+}
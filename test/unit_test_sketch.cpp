@@ -0,0 +1,155 @@
+#include <catch.hpp>
+#include <Executor.h>
+#include <sketch.h>
+
+#include <map>
+#include <random>
+
+using namespace rabid;
+
+namespace {
+
+  /// Zipf-like stream: key k appears scale / (k + 1) times.
+  ///
+  std::vector<size_t> skewed( size_t keys, size_t scale )
+  {
+    std::vector<size_t> result;
+    for( size_t key = 0; key < keys; ++key )
+    {
+      result.insert( result.end(), scale / ( key + 1 ), key );
+    }
+    std::shuffle( result.begin(), result.end(), std::mt19937{ 7 } );
+    return result;
+  }
+}
+
+SCENARIO( "sketches should bound exact counts" )
+{
+  GIVEN( "a skewed stream split in two" )
+  {
+    const auto stream = skewed( 1000, 20000 );
+    const auto half = stream.begin() + ssize_t( stream.size() / 2 );
+    std::map<size_t,std::uint64_t> exact;
+    for( auto key : stream )
+    {
+      exact[ key ] += 1;
+    }
+
+    WHEN( "counted by merged Count-Min sketches" )
+    {
+      sketch::HeavyHitters<size_t> a{ 8, 2048, 4 };
+      sketch::HeavyHitters<size_t> b{ 8, 2048, 4 };
+      std::for_each( stream.begin(), half, [&a]( size_t key ){ a.insert( key ); } );
+      std::for_each( half, stream.end(), [&b]( size_t key ){ b.insert( key ); } );
+      a.merge( b );
+
+      THEN( "estimates should never undercount, and the heaviest keys should lead" )
+      {
+        REQUIRE( a.sketch().size() == stream.size() );
+        bool bounded = true;
+        for( auto & entry : exact )
+        {
+          bounded = bounded && a.sketch().estimate( entry.first ) >= entry.second;
+        }
+        REQUIRE( bounded );
+
+        const auto top = a.top();
+        REQUIRE( top.size() == 8 );
+        REQUIRE( top[ 0 ].first == 0 );
+        REQUIRE( std::all_of( top.begin(), top.end(), []( const std::pair<size_t,std::uint64_t> & entry ){ return entry.first < 16; } ) );
+      }
+    }
+
+    WHEN( "counted by merged Space-Saving summaries" )
+    {
+      sketch::SpaceSaving<size_t> a{ 64 };
+      sketch::SpaceSaving<size_t> b{ 64 };
+      std::for_each( stream.begin(), half, [&a]( size_t key ){ a.insert( key ); } );
+      std::for_each( half, stream.end(), [&b]( size_t key ){ b.insert( key ); } );
+      a.merge( b );
+
+      THEN( "every counter should bracket the exact count" )
+      {
+        const auto top = a.top();
+        REQUIRE( top.size() == 64 );
+        REQUIRE( std::all_of( top.begin(), top.end(), [&exact]( const sketch::SpaceSaving<size_t>::Counter & counter )
+          {
+            return counter.count - counter.error <= exact[ counter.key ] && exact[ counter.key ] <= counter.count;
+          }) );
+        REQUIRE( top[ 0 ].key == 0 );
+      }
+    }
+  }
+}
+
+SCENARIO( "HyperLogLog should estimate merged cardinality" )
+{
+  GIVEN( "estimators over overlapping key ranges" )
+  {
+    sketch::HyperLogLog<size_t> a{ 12 };
+    sketch::HyperLogLog<size_t> b{ 12 };
+    for( size_t key = 0; key < 60000; ++key )
+    {
+      a.insert( key );
+      b.insert( key + 40000 );
+    }
+
+    THEN( "each estimate should be within a few standard errors" )
+    {
+      REQUIRE( std::abs( a.estimate() - 60000.0 ) < 60000.0 * 0.06 );
+
+      a.merge( b );
+      REQUIRE( std::abs( a.estimate() - 100000.0 ) < 100000.0 * 0.06 );
+    }
+
+    THEN( "small cardinalities should be near exact" )
+    {
+      sketch::HyperLogLog<size_t> small{ 12 };
+      for( size_t key = 0; key < 100; ++key )
+      {
+        small.insert( key );
+        small.insert( key );
+      }
+      REQUIRE( std::abs( small.estimate() - 100.0 ) < 3.0 );
+    }
+  }
+}
+
+SCENARIO( "reductions should merge one sketch per worker" )
+{
+  GIVEN( "an executor with per-worker estimators" )
+  {
+    using Exec = Executor<interconnect::Direct, execution::ThreadModel>;
+    const size_t capacity = 5;
+    const size_t keys = 10000;
+    Exec executor{ capacity };
+
+    std::vector<sketch::HyperLogLog<size_t>> sketches( capacity );
+    double estimate = 0.0;
+    rabid::detail::Join join{ 1 };
+    sketch::Reduction<Exec,sketch::HyperLogLog<size_t>> reduction{ sketches.data(), capacity, [&]( sketch::HyperLogLog<size_t> & result )
+      {
+        estimate = result.estimate();
+        join.notify();
+      }};
+
+    executor.wake();
+    for( size_t index = 0; index < capacity; ++index )
+    {
+      executor.inject( index, [&]
+        {
+          for( size_t key = Exec::current(); key < keys; key += Exec::concurrency() )
+          {
+            sketches[ Exec::current() ].insert( key );
+          }
+          reduction.arrive();
+        });
+    }
+    join.wait();
+
+    THEN( "the root should see every worker's keys" )
+    {
+      REQUIRE( std::abs( estimate - double( keys ) ) < double( keys ) * 0.06 );
+    }
+  }
+}